@@ -0,0 +1,19 @@
+#version 330 core
+
+// Compact vertex layout, see yui::CompactVertex.
+layout(location = 0) in vec2 Position;
+layout(location = 2) in vec2 UV; // half floats, negative when the vertex isn't textured
+layout(location = 3) in vec4 Color; // normalized from RGBA8
+
+uniform mat4 ProjMtx;
+flat out float Frag_UseSampler;
+out vec2 Frag_UV;
+out vec4 Frag_Color;
+
+void main()
+{
+	Frag_Color = Color;
+	Frag_UV = UV;
+	Frag_UseSampler = UV.x < 0.0 ? 0.0 : 1.0;
+	gl_Position = ProjMtx * vec4(Position.xy, 0.0, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+flat in float Frag_UseSampler;
+in vec2 Frag_UV;
+in vec4 Frag_Color;
+in vec2 Frag_Position;
+flat in vec4 Frag_Clip;
+layout(location = 0) out vec4 Out_Color;
+
+uniform sampler2D sampler;
+
+void main()
+{
+	if (any(lessThan(Frag_Position, Frag_Clip.xy)) || any(greaterThanEqual(Frag_Position, Frag_Clip.zw))) {
+		discard;
+	}
+
+	if (Frag_UseSampler >= 1.0) {
+		vec4 sampled = vec4(1.0, 1.0, 1.0, texture(sampler, Frag_UV).r);
+		Out_Color = Frag_Color * sampled;
+	}
+	else {
+		Out_Color = Frag_Color;
+	}
+}
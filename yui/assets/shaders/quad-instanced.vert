@@ -0,0 +1,30 @@
+#version 330 core
+
+// One yui::QuadInstance per instance, stretched over the unit quad.
+layout(location = 0) in vec2 Corner; // (0, 0) top left to (1, 1) bottom right
+layout(location = 1) in vec4 Rect; // x, y, width, height
+layout(location = 2) in vec4 UVRect; // u0, v0, u1, v1
+layout(location = 3) in vec4 Color;
+layout(location = 4) in uint Flags; // bit 0: textured, bits 8-15: clip table index
+
+uniform mat4 ProjMtx;
+uniform vec4 ClipRects[64]; // left, top, right, bottom. Index 0 is unclipped.
+
+flat out float Frag_UseSampler;
+out vec2 Frag_UV;
+out vec4 Frag_Color;
+out vec2 Frag_Position;
+flat out vec4 Frag_Clip;
+
+void main()
+{
+	vec2 position = Rect.xy + Corner * Rect.zw;
+	uint clip = (Flags >> 8u) & 255u;
+
+	Frag_Color = Color;
+	Frag_UV = mix(UVRect.xy, UVRect.zw, Corner);
+	Frag_UseSampler = float(Flags & 1u);
+	Frag_Position = position;
+	Frag_Clip = clip == 0u ? vec4(-1e9, -1e9, 1e9, 1e9) : ClipRects[clip];
+	gl_Position = ProjMtx * vec4(position, 0.0, 1.0);
+}
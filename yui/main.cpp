@@ -28,24 +28,37 @@ int main(int argc, char **argv) {
         return parser.release_document();
     };
 
-    auto *document = parse_document("./assets/content/document.ymd");
+    std::unique_ptr<yui::DocumentNode> document{ parse_document("./assets/content/document.ymd") };
     document->load_stylesheet("./assets/content/style.yss");
-    auto widget = std::make_unique<yui::layout::DocumentWidget>(document, window.get());
+    auto widget = std::make_unique<yui::layout::DocumentWidget>(document.get(), window.get());
+    widget->set_parallel_layout(true);
 
     auto reload_document = [&]() {
-        auto *new_document = parse_document("./assets/content/document.ymd");
+        std::unique_ptr<yui::DocumentNode> new_document{ parse_document("./assets/content/document.ymd") };
         new_document->load_stylesheet("./assets/content/style.yss");
-        widget = std::make_unique<yui::layout::DocumentWidget>(new_document, window.get());
+        widget = std::make_unique<yui::layout::DocumentWidget>(new_document.get(), window.get());
+        widget->set_parallel_layout(true);
+        // The old widget is gone, the old document (and its arena) can go too.
+        document = std::move(new_document);
 
         // construct layout tree
         widget->construct_layout_tree();
     };
 
-    window->on_init = [&widget](yui::Window *sender, yui::Painter *painter) {
+    yui::Shader *instanced_shader = nullptr;
+    window->on_init = [&widget, &instanced_shader](yui::Window *sender, yui::Painter *painter) {
         sender->set_clear_color({ 64, 64, 64 });
         // Load default stuff
-        auto *shader = sender->resource_loader().load_shader("./assets/shaders/basic");
+        auto *shader = sender->resource_loader().load_shader(
+                "./assets/shaders/basic-compact.vert",
+                "./assets/shaders/basic.frag"
+        );
         painter->set_shader(shader);
+        painter->set_vertex_format(yui::VertexFormat::Compact);
+        instanced_shader = sender->resource_loader().load_shader("./assets/shaders/quad-instanced");
+        painter->set_instanced_shader(instanced_shader);
+        painter->set_retained(true);
+        sender->resource_loader().set_glyph_cache_directory("./cache");
 
         // Construct layout tree
         widget->construct_layout_tree();
@@ -83,6 +96,16 @@ int main(int argc, char **argv) {
             sender->painter().set_debug(!sender->painter().debug());
         }
 
+        if (key == GLFW_KEY_F9) {
+            // Switch between instanced quads and plain vertices, every node has to record its display list again.
+            auto &painter = sender->painter();
+            painter.set_instanced_shader(painter.instanced() ? nullptr : instanced_shader);
+            painter.damage_all();
+            widget->mark_paint_dirty();
+            sender->request_redraw();
+            spdlog::info("Instanced rendering {}", painter.instanced() ? "on" : "off");
+        }
+
         if (key == GLFW_KEY_F10) {
             reload_document();
             spdlog::info("Reloaded document");
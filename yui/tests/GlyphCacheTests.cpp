@@ -0,0 +1,98 @@
+#include "Test.h"
+#include <filesystem>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include "yui/GlyphCache.h"
+
+namespace {
+
+const std::filesystem::path &cache_directory() {
+    static const auto directory = std::filesystem::temp_directory_path() / "yui-test-glyph-cache";
+    return directory;
+}
+
+// Two glyphs, 2x3 and 1x1 pixels.
+bool write_cache(const std::string &path, uint64_t font_hash, uint32_t pixel_size) {
+    static const uint8_t first[6]{ 1, 2, 3, 4, 5, 6 };
+    static const uint8_t second[1]{ 7 };
+    return yui::GlyphCacheFile::write(path, font_hash, pixel_size, {
+            { .code_point = 'a', .size = { 2, 3 }, .bearing = { 1, 3 }, .advance = 128, .pixels = first },
+            { .code_point = 'b', .size = { 1, 1 }, .bearing = { 0, 1 }, .advance = 64, .pixels = second }
+    });
+}
+
+}
+
+TEST_CASE(glyph_cache_round_trips) {
+    const auto path = (cache_directory() / "round-trip.ygc").string();
+    REQUIRE(write_cache(path, 42, 16));
+
+    yui::GlyphCacheFile file{ };
+    REQUIRE(file.open(path, 42, 16));
+    REQUIRE(file.glyph_count() == 2);
+
+    const auto first = file.glyph(0);
+    CHECK(first.code_point == 'a');
+    CHECK(first.size == glm::ivec2{ 2, 3 });
+    CHECK(first.bearing == glm::ivec2{ 1, 3 });
+    CHECK(first.advance == 128);
+    CHECK(first.pixels[0] == 1 && first.pixels[5] == 6);
+
+    const auto second = file.glyph(1);
+    CHECK(second.code_point == 'b');
+    CHECK(second.pixels[0] == 7);
+}
+
+TEST_CASE(glyph_cache_rejects_stale_and_truncated_files) {
+    const auto path = (cache_directory() / "stale.ygc").string();
+    REQUIRE(write_cache(path, 42, 16));
+
+    yui::GlyphCacheFile file{ };
+    CHECK(!file.open(path, 43, 16));
+    CHECK(!file.open(path, 42, 17));
+    // A font that can't be read hashes to 0, which never opens a cache.
+    CHECK(!file.open(path, 0, 16));
+
+    // Cut off the last pixel, the second glyph now points past the end of the file.
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    CHECK(!file.open(path, 42, 16));
+    CHECK(file.glyph_count() == 0);
+
+    // A pixel offset close to the maximum, adding the size of the bitmap wraps around.
+    REQUIRE(write_cache(path, 42, 16));
+    {
+        // Header (24 bytes), then the first record's pixel_offset at byte 32 of it.
+        const auto offset = std::numeric_limits<uint64_t>::max() - 2;
+        std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(24 + 32);
+        out.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+    CHECK(!file.open(path, 42, 16));
+
+    // Not even a whole header.
+    std::filesystem::resize_file(path, 8);
+    CHECK(!file.open(path, 42, 16));
+}
+
+TEST_CASE(glyph_cache_identifies_fonts_by_path_and_contents) {
+    const auto first = cache_directory() / "first" / "font.ttf";
+    const auto second = cache_directory() / "second" / "font.ttf";
+    std::filesystem::create_directories(first.parent_path());
+    std::filesystem::create_directories(second.parent_path());
+    std::ofstream(first, std::ios::binary) << "not really a font";
+    std::ofstream(second, std::ios::binary) << "not really a font either";
+
+    // Same file name, different directories.
+    const auto directory = cache_directory().string();
+    CHECK(yui::GlyphCacheFile::path_for(directory, first.string(), 16)
+                  != yui::GlyphCacheFile::path_for(directory, second.string(), 16));
+    CHECK(yui::GlyphCacheFile::path_for(directory, first.string(), 16)
+                  != yui::GlyphCacheFile::path_for(directory, first.string(), 17));
+
+    const auto hash = yui::GlyphCacheFile::hash_font(first.string());
+    CHECK(hash != 0);
+    CHECK(hash == yui::GlyphCacheFile::hash_font(first.string()));
+    CHECK(hash != yui::GlyphCacheFile::hash_font(second.string()));
+    CHECK(yui::GlyphCacheFile::hash_font((cache_directory() / "missing.ttf").string()) == 0);
+}
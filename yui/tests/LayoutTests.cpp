@@ -0,0 +1,139 @@
+#include "Test.h"
+#include "yui/Painter.h"
+#include "yui/layout/DocumentWidget.h"
+#include "yui/layout/HitGrid.h"
+#include "yui/ymd/DocumentNode.h"
+
+namespace {
+
+// A widget without a window, boxes only, so nothing needs fonts or GL.
+struct Layout {
+    explicit Layout(const std::string &ymd, const std::string &yss)
+            : document(yui::test::load_document(ymd, yss)),
+              widget(std::make_unique<yui::layout::DocumentWidget>(document.get(), nullptr)) {
+        widget->construct_layout_tree();
+    }
+
+    yui::Node *node(const std::string &id) { return document->get_node_by_id(id); }
+
+    const yui::layout::LayoutNode *layout_node(const std::string &id) {
+        return widget->find_layout_node(node(id));
+    }
+
+    // Records the display lists (no GL involved), which clears the repaint bits.
+    void paint() {
+        yui::Painter painter{ nullptr };
+        widget->paint(painter);
+    }
+
+    static glm::ivec2 center(const yui::layout::LayoutNode &node) {
+        const auto rect = node.absolute_rect();
+        return { (rect.left + rect.right) / 2, (rect.top + rect.bottom) / 2 };
+    }
+
+    std::unique_ptr<yui::DocumentNode> document;
+    std::unique_ptr<yui::layout::DocumentWidget> widget;
+};
+
+bool same_rect(const yui::layout::Rect &a, const yui::layout::Rect &b) {
+    return a.top == b.top && a.left == b.left && a.bottom == b.bottom && a.right == b.right;
+}
+
+// The widget lays out a single root, the rows are stacked inside of it.
+const std::string STACK =
+        R"(<doc><div id="root"><div id="a"></div><div id="b"><div id="c"></div></div><div id="d"></div></div></doc>)";
+const std::string STACK_STYLE =
+        "div { padding-x: 10px; padding-y: 10px; } #a:focus { padding-y: 30px; } #b:hover { background-color: #ff0000; }";
+
+}
+
+TEST_CASE(hit_grid_finds_the_innermost_node) {
+    Layout layout{ STACK, STACK_STYLE };
+    const auto *b = layout.layout_node("b");
+    const auto *c = layout.layout_node("c");
+    REQUIRE(b != nullptr && c != nullptr);
+
+    yui::layout::HitGrid grid{ };
+    grid.rebuild(*layout.widget);
+    CHECK(grid.hit(Layout::center(*c)) == c);
+    CHECK(grid.hit({ b->absolute_rect().left + 1, b->absolute_rect().top + 1 }) == b);
+    CHECK(grid.hit({ -5000, -5000 }) == nullptr);
+}
+
+TEST_CASE(hover_clears_when_the_cursor_leaves_for_empty_space) {
+    Layout layout{ STACK, STACK_STYLE };
+    const auto *b = layout.layout_node("b");
+    REQUIRE(b != nullptr);
+    const auto point = Layout::center(*b);
+
+    layout.widget->mouse_move(point.x + 1, b->absolute_rect().top + 1);
+    CHECK(layout.node("b")->hovered());
+
+    layout.widget->mouse_move(5000, 5000);
+    CHECK(!layout.node("b")->hovered());
+    CHECK(layout.document->current_ui_state_node(yui::NodeUiState::Hovered) == nullptr);
+
+    // The :hover style goes away with it.
+    layout.widget->update(0.f);
+    CHECK(layout.node("b")->computed().background_color() == yui::Color{ 0, 0, 0, 0 });
+}
+
+TEST_CASE(focus_change_repaints_the_node_that_lost_focus) {
+    Layout layout{ STACK, STACK_STYLE };
+    const auto *c = layout.layout_node("c");
+    const auto *d = layout.layout_node("d");
+    REQUIRE(c != nullptr && d != nullptr);
+
+    const auto c_center = Layout::center(*c);
+    layout.widget->mouse_left_up(c_center.x, c_center.y);
+    CHECK(layout.node("c")->focused());
+    layout.widget->update(0.f);
+    layout.paint();
+    CHECK(!c->needs_repaint());
+
+    const auto d_center = Layout::center(*d);
+    layout.widget->mouse_left_up(d_center.x, d_center.y);
+    CHECK(layout.node("d")->focused());
+    CHECK(!layout.node("c")->focused());
+    CHECK(c->needs_repaint());
+    CHECK(d->needs_repaint());
+}
+
+TEST_CASE(incremental_relayout_matches_a_full_layout) {
+    Layout layout{ STACK, STACK_STYLE };
+    const auto *a = layout.layout_node("a");
+    REQUIRE(a != nullptr);
+    const auto a_size = a->size_with_padding();
+    const auto d_top = layout.layout_node("d")->absolute_rect().top;
+
+    // #a:focus is a layout change, the siblings below it move down.
+    layout.node("a")->set_focused(true);
+    layout.widget->update(0.f);
+    CHECK(a->size_with_padding().y == a_size.y + 40);
+    CHECK(layout.layout_node("d")->absolute_rect().top == d_top + 40);
+
+    yui::layout::DocumentWidget fresh{ layout.document.get(), nullptr };
+    fresh.construct_layout_tree();
+    for (const auto *id : { "a", "b", "c", "d" }) {
+        const auto *incremental = layout.layout_node(id);
+        const auto *full = fresh.find_layout_node(layout.node(id));
+        REQUIRE(incremental != nullptr && full != nullptr);
+        CHECK(same_rect(incremental->absolute_rect(), full->absolute_rect()));
+    }
+}
+
+TEST_CASE(paint_only_restyle_keeps_the_layout) {
+    Layout layout{ STACK, STACK_STYLE };
+    const auto *b = layout.layout_node("b");
+    const auto *d = layout.layout_node("d");
+    REQUIRE(b != nullptr && d != nullptr);
+    layout.paint();
+    const auto b_rect = b->absolute_rect();
+
+    layout.node("b")->set_hovered(true);
+    layout.widget->update(0.f);
+    CHECK(same_rect(b->absolute_rect(), b_rect));
+    CHECK(b->needs_repaint());
+    CHECK(!d->needs_repaint());
+    CHECK(!layout.widget->needs_layout());
+}
@@ -0,0 +1,186 @@
+#include "Test.h"
+#include "yui/ymd/DocumentNode.h"
+#include "yui/yss/AncestorFilter.h"
+#include "yui/yss/RuleIndex.h"
+#include "yui/yss/StylesheetDeclaration.h"
+#include "yui/yss/StylesheetLexer.h"
+#include "yui/yss/StylesheetParser.h"
+
+namespace {
+
+yui::Node *by_id(yui::DocumentNode &document, const std::string &id) {
+    return document.get_node_by_id(id);
+}
+
+}
+
+TEST_CASE(selector_matches_tag_class_and_id) {
+    auto document = yui::test::load_document(
+            R"(<doc><div id="a" class="x y"></div><div id="b" class="y"></div></doc>)",
+            "div.x { padding-x: 1px; } #b { padding-x: 2px; } .y { padding-y: 3px; }"
+    );
+    auto *a = by_id(*document, "a");
+    auto *b = by_id(*document, "b");
+    REQUIRE(a != nullptr && b != nullptr);
+
+    CHECK(a->computed().padding().x == 1);
+    CHECK(a->computed().padding().y == 3);
+    CHECK(b->computed().padding().x == 2);
+    CHECK(b->computed().padding().y == 3);
+}
+
+TEST_CASE(selector_matches_descendant_and_child_combinators) {
+    auto document = yui::test::load_document(
+            R"(<doc><div class="outer"><div id="child"><div id="grandchild"></div></div></div></doc>)",
+            "div { padding-x: 0; padding-y: 0; } .outer div { padding-x: 1px; } .outer > div { padding-y: 2px; }"
+    );
+    auto *child = by_id(*document, "child");
+    auto *grandchild = by_id(*document, "grandchild");
+    REQUIRE(child != nullptr && grandchild != nullptr);
+
+    CHECK(child->computed().padding().x == 1);
+    CHECK(child->computed().padding().y == 2);
+    CHECK(grandchild->computed().padding().x == 1);
+    CHECK(grandchild->computed().padding().y == 0);
+}
+
+TEST_CASE(id_is_interned_and_matched_as_atom) {
+    auto document = yui::test::load_document(
+            R"(<doc><div id="first"></div></doc>)",
+            "#first { padding-x: 1px; } #second { padding-x: 2px; }"
+    );
+    auto *node = by_id(*document, "first");
+    REQUIRE(node != nullptr);
+    CHECK(node->id() == yui::Atom{ "first" });
+    CHECK(node->computed().padding().x == 1);
+
+    node->set_attribute("id", "second");
+    CHECK(node->id() == yui::Atom{ "second" });
+    document->compute_styles();
+    CHECK(node->computed().padding().x == 2);
+}
+
+TEST_CASE(rule_index_only_offers_rules_that_can_match) {
+    auto document = yui::test::load_document(R"(<doc><div id="a" class="x"></div></doc>)", "");
+    auto *a = by_id(*document, "a");
+    REQUIRE(a != nullptr);
+
+    yui::StylesheetParser parser{ yui::StylesheetLexer{
+            "* { padding-x: 1px; } div { padding-x: 2px; } span { padding-x: 3px; } .x { padding-x: 4px; } "
+            ".z { padding-x: 5px; } #a { padding-x: 6px; } #b { padding-x: 7px; } span div.x { padding-x: 8px; }"
+    } };
+    auto &declarations = parser.declarations();
+    REQUIRE(declarations.size() == 8);
+
+    yui::RuleIndex index{ };
+    for (uint32_t i = 0; i < declarations.size(); ++i) {
+        declarations[i].set_cascade_order(i);
+        index.add(declarations[i]);
+    }
+
+    std::vector<yui::StylesheetDeclaration *> candidates{ };
+    index.candidates(*a, candidates);
+
+    // The rightmost compound decides the bucket, "span div.x" is only rejected by matching.
+    const std::vector<yui::StylesheetDeclaration *> expected{
+            &declarations[0], &declarations[1], &declarations[3], &declarations[5], &declarations[7]
+    };
+    CHECK(candidates == expected);
+    CHECK(!declarations[7].match(*a));
+}
+
+TEST_CASE(ancestor_filter_holds_exactly_the_ancestors) {
+    auto document = yui::test::load_document(
+            R"(<doc><div id="outer" class="a"><span id="inner" class="b"><div id="leaf"></div></span></div><p id="other"></p></doc>)",
+            ""
+    );
+    auto *leaf = by_id(*document, "leaf");
+    auto *other = by_id(*document, "other");
+    REQUIRE(leaf != nullptr && other != nullptr);
+
+    using yui::AncestorFilter;
+    AncestorFilter filter{ };
+    filter.prepare_for(*leaf);
+    CHECK(filter.might_contain(AncestorFilter::hash_tag("span")));
+    CHECK(filter.might_contain(AncestorFilter::hash_class("a")));
+    CHECK(filter.might_contain(AncestorFilter::hash_class("b")));
+    CHECK(filter.might_contain(AncestorFilter::hash_id("outer")));
+    CHECK(filter.might_contain(AncestorFilter::hash_id("inner")));
+    // The node itself isn't its own ancestor.
+    CHECK(!filter.might_contain(AncestorFilter::hash_id("leaf")));
+
+    // Moving to a node elsewhere in the tree pops what isn't its ancestor anymore.
+    filter.prepare_for(*other);
+    CHECK(!filter.might_contain(AncestorFilter::hash_tag("span")));
+    CHECK(!filter.might_contain(AncestorFilter::hash_class("a")));
+    CHECK(!filter.might_contain(AncestorFilter::hash_id("outer")));
+}
+
+TEST_CASE(ancestor_filter_never_rejects_a_match) {
+    auto document = yui::test::load_document(
+            R"(<doc><div class="a"><span><div id="leaf"></div></span></div></doc>)",
+            ".a span > div { padding-x: 1px; } .b div { padding-x: 2px; }"
+    );
+    auto *leaf = by_id(*document, "leaf");
+    REQUIRE(leaf != nullptr);
+
+    yui::StylesheetParser parser{ yui::StylesheetLexer{ ".a span > div { } .b div { }" } };
+    REQUIRE(parser.declarations().size() == 2);
+    yui::AncestorFilter filter{ };
+    filter.prepare_for(*leaf);
+    CHECK(parser.declarations()[0].match(*leaf, &filter));
+    CHECK(!parser.declarations()[1].match(*leaf, &filter));
+    CHECK(leaf->computed().padding().x == 1);
+}
+
+TEST_CASE(computed_difference_reports_what_a_change_invalidates) {
+    using yui::StylesheetPropertyEffect;
+    const yui::ImmutableComputedValues base{ };
+    const auto changed = [&](auto &&set) {
+        auto values = base.mutable_();
+        set(values);
+        return values.immutable();
+    };
+
+    CHECK(base.difference(base) == StylesheetPropertyEffect::None);
+    CHECK(base.difference(changed([](auto &v) { v.set_background_color({ 1, 2, 3 }); })) == StylesheetPropertyEffect::Paint);
+    CHECK(base.difference(changed([](auto &v) { v.set_padding_x(7); })) == StylesheetPropertyEffect::Layout);
+    CHECK(base.difference(changed([](auto &v) { v.set_text_color({ 1, 2, 3 }); }))
+                  == (StylesheetPropertyEffect::Paint | StylesheetPropertyEffect::Inherit));
+    CHECK(base.difference(changed([](auto &v) { v.set_font_size(31); }))
+                  == (StylesheetPropertyEffect::Layout | StylesheetPropertyEffect::Inherit));
+
+    // Equal values built separately are interned into the same groups.
+    const auto first = changed([](auto &v) { v.set_padding_x(7); });
+    const auto second = changed([](auto &v) { v.set_padding_x(7); });
+    CHECK(first == second);
+    CHECK(first.difference(second) == StylesheetPropertyEffect::None);
+}
+
+TEST_CASE(ui_state_change_restyles_with_the_effects_of_what_changed) {
+    auto document = yui::test::load_document(
+            R"(<doc><div id="a"></div><div id="b"></div></doc>)",
+            "div { padding-x: 0; } #a:hover { background-color: #ff0000; } #b:focus { padding-x: 9px; }"
+    );
+    auto *a = by_id(*document, "a");
+    auto *b = by_id(*document, "b");
+    REQUIRE(a != nullptr && b != nullptr);
+
+    a->set_hovered(true);
+    b->set_focused(true);
+    std::vector<yui::RestyledNode> restyled{ };
+    document->update_styles(restyled);
+
+    const auto effects_of = [&](yui::Node *node) {
+        for (const auto &entry : restyled) {
+            if (entry.node == node) {
+                return entry.effects;
+            }
+        }
+        return yui::StylesheetPropertyEffect::None;
+    };
+    CHECK(restyled.size() == 2);
+    CHECK(effects_of(a) == yui::StylesheetPropertyEffect::Paint);
+    CHECK(effects_of(b) == yui::StylesheetPropertyEffect::Layout);
+    CHECK(b->computed().padding().x == 9);
+}
@@ -0,0 +1,59 @@
+#include "Test.h"
+#include <atomic>
+#include "yui/TaskPool.h"
+
+namespace {
+
+// Forks both halves and waits for them from inside a task, the way nested subtrees are laid out.
+int fibonacci(yui::TaskPool &pool, int n) {
+    if (n < 2) {
+        return n;
+    }
+
+    int first = 0, second = 0;
+    yui::TaskPool::Group group{ };
+    pool.run(group, [&]() { first = fibonacci(pool, n - 1); });
+    pool.run(group, [&]() { second = fibonacci(pool, n - 2); });
+    pool.wait(group);
+    return first + second;
+}
+
+}
+
+TEST_CASE(task_pool_runs_inline_when_not_started) {
+    yui::TaskPool pool{ };
+    CHECK(!pool.running());
+
+    auto ran = false;
+    yui::TaskPool::Group group{ };
+    pool.run(group, [&]() { ran = true; });
+    // Nothing was queued, the task already ran.
+    CHECK(ran);
+    pool.wait(group);
+    CHECK(fibonacci(pool, 10) == 55);
+}
+
+TEST_CASE(task_pool_waits_for_every_task_of_a_group) {
+    yui::TaskPool pool{ };
+    pool.start(3);
+    REQUIRE(pool.running() && pool.worker_count() == 3);
+
+    std::atomic<int> count{ 0 };
+    yui::TaskPool::Group group{ };
+    for (auto i = 0; i < 1000; ++i) {
+        pool.run(group, [&]() { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    pool.wait(group);
+    CHECK(count.load() == 1000);
+}
+
+TEST_CASE(task_pool_tasks_can_fork_and_wait) {
+    yui::TaskPool pool{ };
+    pool.start(3);
+
+    // Waiting inside of a task must not deadlock, even with more nested waits than workers.
+    CHECK(fibonacci(pool, 18) == 2584);
+
+    pool.stop();
+    CHECK(!pool.running());
+}
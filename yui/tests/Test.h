@@ -0,0 +1,52 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yui {
+class DocumentNode;
+}
+
+namespace yui::test {
+
+struct TestCase {
+    const char *name{ nullptr };
+    void (*function)(){ nullptr };
+};
+
+std::vector<TestCase> &registry();
+// Records a failed check of the running test, which keeps running.
+void fail(const char *file, int line, const std::string &expression);
+
+struct Registrar {
+    Registrar(const char *name, void (*function)()) {
+        registry().emplace_back(TestCase{ .name = name, .function = function });
+    }
+};
+
+// Parses `ymd` and loads `yss` as its stylesheet (through a temporary file), styles are computed.
+std::unique_ptr<DocumentNode> load_document(const std::string &ymd, const std::string &yss);
+
+}
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static const yui::test::Registrar name##_registrar{ #name, name }; \
+    static void name()
+
+// Variadic, so braced initializers with commas don't need extra parentheses.
+#define CHECK(...) \
+    do { \
+        if (!(__VA_ARGS__)) { \
+            yui::test::fail(__FILE__, __LINE__, #__VA_ARGS__); \
+        } \
+    } while (false)
+
+// Stops the test, for checks the rest of it depends on.
+#define REQUIRE(...) \
+    do { \
+        if (!(__VA_ARGS__)) { \
+            yui::test::fail(__FILE__, __LINE__, #__VA_ARGS__); \
+            return; \
+        } \
+    } while (false)
@@ -0,0 +1,60 @@
+#include "Test.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include "yui/ymd/DocumentNode.h"
+#include "yui/ymd/DocumentParser.h"
+
+static size_t g_failures = 0;
+
+std::vector<yui::test::TestCase> &yui::test::registry() {
+    static std::vector<TestCase> tests{ };
+    return tests;
+}
+
+void yui::test::fail(const char *file, int line, const std::string &expression) {
+    std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed\n";
+    ++g_failures;
+}
+
+std::unique_ptr<yui::DocumentNode> yui::test::load_document(const std::string &ymd, const std::string &yss) {
+    static std::atomic<int> counter{ 0 };
+    const auto path = std::filesystem::temp_directory_path() / ("yui-test-" + std::to_string(counter++) + ".yss");
+    std::ofstream(path) << yss;
+
+    DocumentParser parser{ DocumentLexer{ ymd } };
+    std::unique_ptr<DocumentNode> document{ parser.release_document() };
+    document->load_stylesheet(path.string());
+    document->compute_styles();
+
+    std::error_code error{ };
+    std::filesystem::remove(path, error);
+    return document;
+}
+
+// Runs every test, or only those whose name contains the first argument.
+int main(int argc, char **argv) {
+    const std::string_view filter = argc > 1 ? argv[1] : "";
+    size_t failed_tests = 0;
+    size_t ran = 0;
+
+    for (const auto &test : yui::test::registry()) {
+        if (!filter.empty() && std::string_view{ test.name }.find(filter) == std::string_view::npos) {
+            continue;
+        }
+
+        const auto failures_before = g_failures;
+        test.function();
+        ++ran;
+
+        if (g_failures != failures_before) {
+            std::cerr << "FAILED " << test.name << "\n";
+            ++failed_tests;
+        }
+    }
+
+    std::cout << ran - failed_tests << "/" << ran << " tests passed\n";
+    return failed_tests == 0 ? 0 : 1;
+}
@@ -1,6 +1,9 @@
 #include "Application.h"
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <limits>
+#include <thread>
 #include "Window.h"
 #include "io/Profiler.h"
 #include "spdlog/spdlog.h"
@@ -35,7 +38,17 @@ int yui::Application::exec() {
     glEnable(GL_TEXTURE_2D);
     io::Profiler<> bm;
     while (!m_halting) {
-        glfwPollEvents();
+        wait_for_events();
+
+        // Text drawn with placeholders needs another frame once its glyphs are in.
+        if (m_glyph_rasterizer.take_completed()) {
+            for (auto &[_, instance] : m_window_map) {
+                instance.window->request_redraw();
+            }
+        }
+
+        const auto now = glfwGetTime();
+        auto did_refresh = false;
         for (auto it = m_window_map.begin(); it != m_window_map.end();) {
             auto &[_, instance] = *it;
 
@@ -53,14 +66,70 @@ int yui::Application::exec() {
                 continue;
             }
 
-            // Refresh window
-            do_window_refresh(instance);
+            // Refresh window, unless nothing asked for it.
+            if (!instance.initialized || instance.window->redraw_due(now)) {
+                do_window_refresh(instance);
+                did_refresh = true;
+            }
             ++it;
         }
+
+        if (did_refresh) {
+            pace_frame();
+        }
     }
     return 0;
 }
 
+void yui::Application::wait_for_events() {
+    const auto now = glfwGetTime();
+    auto next_deadline = std::numeric_limits<double>::infinity();
+
+    for (auto &[_, instance] : m_window_map) {
+        if (!instance.initialized || instance.window->redraw_due(now) || instance.window->closing()) {
+            glfwPollEvents();
+            return;
+        }
+
+        if (instance.window->redraw_deadline() > 0.0) {
+            next_deadline = std::min(next_deadline, instance.window->redraw_deadline());
+        }
+    }
+
+    if (next_deadline == std::numeric_limits<double>::infinity()) {
+        glfwWaitEvents();
+    } else {
+        glfwWaitEventsTimeout(std::max(next_deadline - now, 0.0));
+    }
+}
+
+void yui::Application::set_frame_rate_limit(int fps) {
+    m_frame_rate_limit = std::max(fps, 0);
+}
+
+void yui::Application::pace_frame() {
+    if (m_frame_rate_limit == 0) {
+        return;
+    }
+
+    const auto frame_time = 1.0 / m_frame_rate_limit;
+    const auto target = m_last_frame_time + frame_time;
+
+    // The OS sleep is only accurate to a millisecond or so, spin through the remainder.
+    constexpr auto spin_threshold = 0.002;
+    auto now = glfwGetTime();
+    if (target - now > spin_threshold) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(target - now - spin_threshold));
+    }
+
+    while ((now = glfwGetTime()) < target) {
+        std::this_thread::yield();
+    }
+
+    // Don't try to catch up after a long idle period.
+    m_last_frame_time = now - target > frame_time ? now : target;
+}
+
 void yui::Application::halt(int exit_code) {
     m_exit_code = exit_code;
     m_halting = true;
@@ -117,6 +186,13 @@ void yui::Application::do_window_refresh(WindowInstance &instance) {
         instance.initialized = true;
     }
 
+    // Input that arrived since the last frame, coalesced. Its handlers ask for the frame that is
+    // about to be drawn, so the request is only cleared after dispatching.
+    instance.window->dispatch_events();
+
+    // Whatever happens during update/paint may ask for another frame.
+    instance.window->did_redraw();
+
     // Update
     const auto delta = instance.timer.update();
     instance.window->update(delta);
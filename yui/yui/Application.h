@@ -4,12 +4,14 @@
 #include <vector>
 #include "includes.h"
 #include "FrameTimer.h"
+#include "GlyphRasterizer.h"
+#include "TaskPool.h"
 #include "io/Profiler.h"
 
 #define BENCHMARK
 
 #ifdef BENCHMARK
-#define BENCHMARK_BEGIN yui::Application::the().profiler().run(__FUNCTION__, [&]() {
+#define BENCHMARK_BEGIN yui::Application::profile(__FUNCTION__, [&]() {
 #define BENCHMARK_END });
 #else
 #define BENCHMARK_BEGIN
@@ -30,6 +32,11 @@ public:
     int exec();
 
     FT_Library freetype() { return m_freetype_library; }
+    // Fonts rasterize new glyphs on this pool, it starts with the first glyph that isn't cached.
+    // When disabled they rasterize synchronously.
+    GlyphRasterizer &glyph_rasterizer() { return m_glyph_rasterizer; }
+    // Not started until something asks for it, see DocumentWidget::set_parallel_layout().
+    TaskPool &task_pool() { return m_task_pool; }
 
     [[nodiscard]] bool halting() const { return m_halting; }
     void halt(int exit_code = 0);
@@ -46,8 +53,25 @@ public:
     void window_refresh(Window *);
 
     io::Profiler<> &profiler() { return m_profiler; }
+    // Runs `callable` through the profiler of the application, or just runs it when there is none (tests).
+    template<typename Callable>
+    static void profile(std::string_view name, Callable &&callable) {
+        if (!initialized()) {
+            callable();
+            return;
+        }
+        the().profiler().run(name, std::forward<Callable>(callable));
+    }
+
+    // Upper bound on frames per second across all windows, 0 means unlimited.
+    [[nodiscard]] int frame_rate_limit() const { return m_frame_rate_limit; }
+    void set_frame_rate_limit(int fps);
 private:
     void do_window_refresh(WindowInstance &);
+    // Polls when a window is dirty, otherwise sleeps until input arrives or the next deadline.
+    void wait_for_events();
+    // Sleeps (then spins for the last bit) until the next frame is allowed to start.
+    void pace_frame();
 
 private:
     struct WindowInstance {
@@ -67,7 +91,11 @@ private:
     int m_exit_code{ 0 };
     std::map<uint32_t, WindowInstance> m_window_map{ };
     FT_Library m_freetype_library{ };
+    GlyphRasterizer m_glyph_rasterizer{ };
+    TaskPool m_task_pool{ };
     uint32_t m_window_counter{ 0 };
     io::Profiler<> m_profiler{ };
+    int m_frame_rate_limit{ 0 };
+    double m_last_frame_time{ 0.0 };
 };
 }
@@ -0,0 +1,67 @@
+#include "Atom.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace {
+
+// Lookups (the common case, every name that's parsed a second time) only take the shared lock.
+class AtomTable {
+public:
+    AtomTable() {
+        m_strings.emplace_back();
+        m_ids.emplace(m_strings.back(), 0);
+    }
+
+    uint32_t intern(std::string_view value) {
+        if (const auto id = find(value); id != 0 || value.empty()) {
+            return id;
+        }
+
+        std::unique_lock lock(m_mutex);
+        // Someone else could have interned it between the two locks.
+        if (const auto it = m_ids.find(value); it != m_ids.end()) {
+            return it->second;
+        }
+
+        const auto id = static_cast<uint32_t>(m_strings.size());
+        m_strings.emplace_back(value);
+        m_ids.emplace(m_strings.back(), id);
+        return id;
+    }
+
+    uint32_t find(std::string_view value) const {
+        std::shared_lock lock(m_mutex);
+        const auto it = m_ids.find(value);
+        return it != m_ids.end() ? it->second : 0;
+    }
+
+    const std::string &str(uint32_t id) const {
+        std::shared_lock lock(m_mutex);
+        return m_strings[id];
+    }
+private:
+    mutable std::shared_mutex m_mutex{ };
+    // A deque never moves its elements, the keys of m_ids view into it.
+    std::deque<std::string> m_strings{ };
+    std::unordered_map<std::string_view, uint32_t> m_ids{ };
+};
+
+AtomTable &atom_table() {
+    static AtomTable table{ };
+    return table;
+}
+
+}
+
+yui::Atom::Atom(std::string_view value)
+        : m_id(atom_table().intern(value)) {}
+
+yui::Atom yui::Atom::find(std::string_view value) {
+    return Atom{ atom_table().find(value) };
+}
+
+const std::string &yui::Atom::str() const {
+    return atom_table().str(m_id);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace yui {
+
+// An interned string. Equal strings share one id in a process wide table, so comparing
+// and hashing atoms is an integer operation. The empty string is always id 0.
+// Atoms are never removed from the table, only intern names (tags, ids, classes, font names).
+class Atom {
+public:
+    Atom() = default;
+    Atom(std::string_view);
+    Atom(const std::string &value) : Atom(std::string_view{ value }) {}
+    Atom(const char *value) : Atom(std::string_view{ value }) {}
+
+    // Looks `value` up without interning it, an empty atom when it isn't in the table.
+    // For lookups with strings that can't match anything interned, e.g. an arbitrary attribute.
+    [[nodiscard]] static Atom find(std::string_view value);
+
+    [[nodiscard]] uint32_t id() const { return m_id; }
+    [[nodiscard]] bool empty() const { return m_id == 0; }
+    [[nodiscard]] const std::string &str() const;
+
+    bool operator==(const Atom &other) const { return m_id == other.m_id; }
+    bool operator!=(const Atom &other) const { return m_id != other.m_id; }
+    // Ordered by id, not alphabetically.
+    bool operator<(const Atom &other) const { return m_id < other.m_id; }
+
+    bool operator==(std::string_view other) const { return str() == other; }
+    bool operator!=(std::string_view other) const { return str() != other; }
+    bool operator==(const std::string &other) const { return str() == other; }
+    bool operator!=(const std::string &other) const { return str() != other; }
+    bool operator==(const char *other) const { return str() == other; }
+    bool operator!=(const char *other) const { return str() != other; }
+private:
+    explicit Atom(uint32_t id) : m_id(id) {}
+private:
+    uint32_t m_id{ 0 };
+};
+
+inline std::ostream &operator<<(std::ostream &os, const Atom &atom) {
+    return os << atom.str();
+}
+
+}
+
+template<>
+struct std::hash<yui::Atom> {
+    size_t operator()(const yui::Atom &atom) const noexcept {
+        return atom.id();
+    }
+};
@@ -0,0 +1,137 @@
+#include "GlyphAtlas.h"
+#include <algorithm>
+#include <cstring>
+#include "includes.h"
+
+yui::GlyphAtlas::~GlyphAtlas() {
+    clear();
+}
+
+yui::AtlasRegion yui::GlyphAtlas::insert(int width, int height, const uint8_t *pixels, int pitch) {
+    if (width <= 0 || height <= 0 || width + PADDING * 2 > PAGE_SIZE || height + PADDING * 2 > PAGE_SIZE) {
+        return { };
+    }
+
+    glm::ivec2 position{ };
+    Page *page = m_pages.empty() ? nullptr : &m_pages.back();
+
+    // Older pages are considered full, only the most recent page is packed into.
+    if (page == nullptr || !allocate(*page, width, height, position)) {
+        page = &create_page();
+        allocate(*page, width, height, position);
+    }
+
+    for (auto row = 0; row < height; ++row) {
+        std::memcpy(
+                page->pixels.data() + (position.y + row) * PAGE_SIZE + position.x,
+                pixels + row * pitch,
+                static_cast<size_t>(width)
+        );
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch);
+    glBindTexture(GL_TEXTURE_2D, page->texture_id);
+    glTexSubImage2D(
+            GL_TEXTURE_2D,
+            0,
+            position.x,
+            position.y,
+            width,
+            height,
+            GL_RED,
+            GL_UNSIGNED_BYTE,
+            pixels
+    );
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    constexpr auto size = static_cast<float>(PAGE_SIZE);
+    return {
+            .texture_id = page->texture_id,
+            .position = position,
+            .size = { width, height },
+            .uv = {
+                    static_cast<float>(position.x) / size,
+                    static_cast<float>(position.y) / size,
+                    static_cast<float>(position.x + width) / size,
+                    static_cast<float>(position.y + height) / size,
+            }
+    };
+}
+
+bool yui::GlyphAtlas::read(uint32_t texture_id, glm::ivec2 position, glm::ivec2 size, uint8_t *out) const {
+    const auto page = std::find_if(m_pages.begin(), m_pages.end(), [&](const Page &candidate) {
+        return candidate.texture_id == texture_id;
+    });
+
+    if (page == m_pages.end() || position.x + size.x > PAGE_SIZE || position.y + size.y > PAGE_SIZE) {
+        return false;
+    }
+
+    for (auto row = 0; row < size.y; ++row) {
+        std::memcpy(
+                out + row * size.x,
+                page->pixels.data() + (position.y + row) * PAGE_SIZE + position.x,
+                static_cast<size_t>(size.x)
+        );
+    }
+    return true;
+}
+
+void yui::GlyphAtlas::clear() {
+    for (auto &page : m_pages) {
+        glDeleteTextures(1, &page.texture_id);
+    }
+    m_pages.clear();
+}
+
+bool yui::GlyphAtlas::allocate(Page &page, int width, int height, glm::ivec2 &position) {
+    const auto padded_width = width + PADDING * 2;
+    const auto padded_height = height + PADDING * 2;
+
+    // Start a new shelf when the current one can't fit the width.
+    if (page.shelf_x + padded_width > PAGE_SIZE) {
+        page.shelf_y += page.shelf_height;
+        page.shelf_x = 0;
+        page.shelf_height = 0;
+    }
+
+    if (page.shelf_y + padded_height > PAGE_SIZE) {
+        return false;
+    }
+
+    position = { page.shelf_x + PADDING, page.shelf_y + PADDING };
+    page.shelf_x += padded_width;
+    page.shelf_height = std::max(page.shelf_height, padded_height);
+    return true;
+}
+
+yui::GlyphAtlas::Page &yui::GlyphAtlas::create_page() {
+    // Zero filled, otherwise linear filtering would bleed garbage in from the padding.
+    std::vector<uint8_t> zeroes(PAGE_SIZE * PAGE_SIZE, 0);
+
+    GLuint texture = 0u;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(
+            GL_TEXTURE_2D,
+            0,
+            GL_RED,
+            PAGE_SIZE,
+            PAGE_SIZE,
+            0,
+            GL_RED,
+            GL_UNSIGNED_BYTE,
+            zeroes.data()
+    );
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    spdlog::debug("Created glyph atlas page #{} ({}x{})", m_pages.size(), PAGE_SIZE, PAGE_SIZE);
+    return m_pages.emplace_back(Page{ .texture_id = texture, .pixels = std::move(zeroes) });
+}
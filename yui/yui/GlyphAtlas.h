@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace yui {
+
+// A rectangle inside of one of the atlas pages.
+struct AtlasRegion {
+    uint32_t texture_id{ 0 };
+    glm::ivec2 position{ 0, 0 };
+    glm::ivec2 size{ 0, 0 };
+    glm::fvec4 uv{ 0.f, 0.f, 0.f, 0.f }; // u0, v0, u1, v1
+};
+
+// Packs single channel (GL_RED) bitmaps into large texture pages, so that every glyph
+// of a font (and every font sharing the atlas) can be drawn with the same texture bound.
+class GlyphAtlas {
+public:
+    static constexpr int PAGE_SIZE = 1024;
+    static constexpr int PADDING = 1;
+
+public:
+    GlyphAtlas() = default;
+    GlyphAtlas(const GlyphAtlas &) = delete;
+    GlyphAtlas(GlyphAtlas &&) = delete;
+    ~GlyphAtlas();
+
+    // Uploads the bitmap into a free spot, allocating a new page when the current one is full.
+    // Returns an empty region (texture_id = 0) for empty bitmaps or bitmaps larger than a page.
+    AtlasRegion insert(int width, int height, const uint8_t *pixels, int pitch);
+
+    [[nodiscard]] size_t page_count() const { return m_pages.size(); }
+
+    // Copies a previously inserted bitmap back out of the CPU side copy of its page,
+    // e.g. for writing a glyph cache. `out` must hold size.x * size.y bytes.
+    bool read(uint32_t texture_id, glm::ivec2 position, glm::ivec2 size, uint8_t *out) const;
+
+    // Deletes all pages, every previously returned region becomes invalid.
+    void clear();
+private:
+    struct Page {
+        uint32_t texture_id{ 0 };
+        int shelf_x{ 0 };
+        int shelf_y{ 0 };
+        int shelf_height{ 0 };
+        std::vector<uint8_t> pixels{ }; // Shadow of the texture, so glyphs can be read back without GL.
+    };
+
+    static bool allocate(Page &, int width, int height, glm::ivec2 &position);
+    Page &create_page();
+private:
+    std::vector<Page> m_pages{ };
+};
+
+}
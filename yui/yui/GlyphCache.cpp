@@ -0,0 +1,169 @@
+#include "GlyphCache.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "spdlog/spdlog.h"
+
+static uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t yui::GlyphCacheFile::hash_font(const std::string &font_path) {
+    // Identifies the file without reading all of it: size, modification time and the bytes at both
+    // ends, which hold the table directory and (usually) the last tables.
+    std::error_code error{ };
+    const auto size = std::filesystem::file_size(font_path, error);
+    if (error) {
+        return 0;
+    }
+    const auto mtime = std::filesystem::last_write_time(font_path, error).time_since_epoch().count();
+    if (error) {
+        return 0;
+    }
+
+    std::ifstream in(font_path, std::ios::binary);
+    if (!in) {
+        return 0;
+    }
+
+    char head[IDENTITY_SAMPLE_SIZE]{ };
+    char tail[IDENTITY_SAMPLE_SIZE]{ };
+    const auto sample = static_cast<std::streamsize>(std::min<uintmax_t>(size, IDENTITY_SAMPLE_SIZE));
+    in.read(head, sample);
+    in.seekg(-sample, std::ios::end);
+    in.read(tail, sample);
+    if (!in) {
+        return 0;
+    }
+
+    auto hash = fnv1a(&size, sizeof(size));
+    hash = fnv1a(&mtime, sizeof(mtime), hash);
+    hash = fnv1a(head, static_cast<size_t>(sample), hash);
+    return fnv1a(tail, static_cast<size_t>(sample), hash);
+}
+
+std::string yui::GlyphCacheFile::path_for(
+        const std::string &directory,
+        const std::string &font_path,
+        uint32_t pixel_size
+) {
+    // Fonts with the same file name in different directories must not share a cache file.
+    std::error_code error{ };
+    auto full_path = std::filesystem::absolute(font_path, error).lexically_normal().string();
+    if (error) {
+        full_path = font_path;
+    }
+
+    const auto stem = std::filesystem::path(font_path).stem().string();
+    const auto path_hash = fnv1a(full_path.data(), full_path.size());
+    return (std::filesystem::path(directory) / fmt::format("{}-{:016x}-{}.ygc", stem, path_hash, pixel_size)).string();
+}
+
+bool yui::GlyphCacheFile::write(
+        const std::string &path,
+        uint64_t font_hash,
+        uint32_t pixel_size,
+        const std::vector<GlyphCacheEntry> &glyphs
+) {
+    std::error_code error{ };
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        spdlog::warn("Could not write glyph cache '{}'", path);
+        return false;
+    }
+
+    const Header header{
+            .magic = MAGIC,
+            .pixel_size = pixel_size,
+            .font_hash = font_hash,
+            .glyph_count = static_cast<uint32_t>(glyphs.size()),
+            .reserved = 0
+    };
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    auto pixel_offset = static_cast<uint64_t>(sizeof(Header) + sizeof(Record) * glyphs.size());
+    for (const auto &glyph : glyphs) {
+        const Record record{
+                .code_point = glyph.code_point,
+                .width = glyph.size.x,
+                .height = glyph.size.y,
+                .bearing_x = glyph.bearing.x,
+                .bearing_y = glyph.bearing.y,
+                .reserved = 0,
+                .advance = glyph.advance,
+                .pixel_offset = pixel_offset
+        };
+        out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        pixel_offset += static_cast<uint64_t>(glyph.size.x) * glyph.size.y;
+    }
+
+    for (const auto &glyph : glyphs) {
+        out.write(reinterpret_cast<const char *>(glyph.pixels), static_cast<std::streamsize>(glyph.size.x) * glyph.size.y);
+    }
+
+    return static_cast<bool>(out);
+}
+
+bool yui::GlyphCacheFile::open(const std::string &path, uint64_t font_hash, uint32_t pixel_size) {
+    m_glyph_count = 0;
+    if (font_hash == 0 || !m_file.open(path)) {
+        return false;
+    }
+
+    Header header{ };
+    if (m_file.size() < sizeof(Header)) {
+        m_file.close();
+        return false;
+    }
+    std::memcpy(&header, m_file.data(), sizeof(header));
+
+    if (header.magic != MAGIC || header.font_hash != font_hash || header.pixel_size != pixel_size) {
+        spdlog::info("Glyph cache '{}' is stale, ignoring it", path);
+        m_file.close();
+        return false;
+    }
+
+    // Every record and its pixels have to be inside of the file.
+    if (m_file.size() < sizeof(Header) + sizeof(Record) * static_cast<size_t>(header.glyph_count)) {
+        m_file.close();
+        return false;
+    }
+
+    for (size_t i = 0; i < header.glyph_count; ++i) {
+        Record record{ };
+        std::memcpy(&record, m_file.data() + sizeof(Header) + sizeof(Record) * i, sizeof(record));
+
+        const auto bytes = static_cast<uint64_t>(record.width) * static_cast<uint64_t>(record.height);
+        // Written so a huge offset from a corrupt file can't wrap around.
+        if (record.width < 0 || record.height < 0 || record.pixel_offset > m_file.size()
+                || bytes > m_file.size() - record.pixel_offset) {
+            spdlog::warn("Glyph cache '{}' is truncated, ignoring it", path);
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_glyph_count = header.glyph_count;
+    return true;
+}
+
+yui::GlyphCacheEntry yui::GlyphCacheFile::glyph(size_t index) const {
+    Record record{ };
+    std::memcpy(&record, m_file.data() + sizeof(Header) + sizeof(Record) * index, sizeof(record));
+
+    return {
+            .code_point = record.code_point,
+            .size = { record.width, record.height },
+            .bearing = { record.bearing_x, record.bearing_y },
+            .advance = static_cast<long>(record.advance),
+            .pixels = m_file.data() + record.pixel_offset
+    };
+}
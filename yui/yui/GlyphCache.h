@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "io/MappedFile.h"
+
+namespace yui {
+
+struct GlyphCacheEntry {
+    unsigned code_point{ 0 };
+    glm::ivec2 size{ 0, 0 };
+    glm::ivec2 bearing{ 0, 0 };
+    long advance{ 0 };
+    const uint8_t *pixels{ nullptr }; // size.x * size.y bytes, tightly packed
+};
+
+// Rasterized glyphs of one (font file, pixel size), saved so the next start doesn't go through
+// FreeType again. The file is memory mapped and the bitmaps are uploaded straight from the mapping.
+//
+// Layout: Header, Record[glyph_count], pixel data. A file is only used when the magic, the
+// pixel size and the font hash all match. The font hash covers the font's size, modification
+// time and first/last IDENTITY_SAMPLE_SIZE bytes, so checking a cache never reads the whole font.
+class GlyphCacheFile {
+public:
+    static constexpr uint32_t MAGIC = 0x31434759; // "YGC1"
+    static constexpr size_t IDENTITY_SAMPLE_SIZE = 4096;
+
+    // 0 when the font can't be read, which never matches a valid cache.
+    static uint64_t hash_font(const std::string &font_path);
+    // <directory>/<stem>-<hash of the absolute font path>-<pixel size>.ygc
+    static std::string path_for(const std::string &directory, const std::string &font_path, uint32_t pixel_size);
+    static bool write(
+            const std::string &path,
+            uint64_t font_hash,
+            uint32_t pixel_size,
+            const std::vector<GlyphCacheEntry> &
+    );
+
+    bool open(const std::string &path, uint64_t font_hash, uint32_t pixel_size);
+
+    [[nodiscard]] size_t glyph_count() const { return m_glyph_count; }
+    [[nodiscard]] GlyphCacheEntry glyph(size_t index) const;
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t pixel_size;
+        uint64_t font_hash;
+        uint32_t glyph_count;
+        uint32_t reserved;
+    };
+
+    struct Record {
+        uint32_t code_point;
+        int32_t width, height;
+        int32_t bearing_x, bearing_y;
+        int32_t reserved;
+        int64_t advance;
+        uint64_t pixel_offset; // From the start of the file.
+    };
+private:
+    io::MappedFile m_file{ };
+    size_t m_glyph_count{ 0 };
+};
+
+}
@@ -0,0 +1,143 @@
+#include "GlyphRasterizer.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include "includes.h"
+#include "spdlog/spdlog.h"
+
+yui::GlyphRasterizer::~GlyphRasterizer() {
+    stop();
+}
+
+void yui::GlyphRasterizer::start(unsigned worker_count) {
+    if (running()) {
+        return;
+    }
+
+    if (worker_count == 0) {
+        // Leave room for the GL thread, glyph bursts are short anyway.
+        worker_count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    }
+
+    m_stopping = false;
+    for (auto i = 0u; i < worker_count; ++i) {
+        m_workers.emplace_back(&GlyphRasterizer::work, this);
+    }
+    spdlog::info("Started {} glyph rasterizer worker(s)", worker_count);
+}
+
+void yui::GlyphRasterizer::stop() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+    m_condition.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void yui::GlyphRasterizer::set_enabled(bool enabled) {
+    m_enabled = enabled;
+
+    if (!enabled) {
+        stop();
+    }
+}
+
+void yui::GlyphRasterizer::enqueue(
+        std::shared_ptr<GlyphSink> sink,
+        std::string font_path,
+        uint32_t pixel_size,
+        unsigned code_point
+) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.emplace_back(Job{
+                .sink = std::move(sink),
+                .font_path = std::move(font_path),
+                .pixel_size = pixel_size,
+                .code_point = code_point
+        });
+    }
+    m_condition.notify_one();
+}
+
+void yui::GlyphRasterizer::work() {
+    FT_Library library{ };
+    if (FT_Init_FreeType(&library)) {
+        spdlog::error("Glyph rasterizer worker could not initialize freetype");
+        return;
+    }
+
+    // Faces are opened lazily, per (path, pixel size), and never shared with another thread.
+    std::map<std::pair<std::string, uint32_t>, FT_Face> faces{ };
+    const auto face_for = [&](const Job &job) -> FT_Face {
+        const auto key = std::make_pair(job.font_path, job.pixel_size);
+        if (const auto it = faces.find(key); it != faces.end()) {
+            return it->second;
+        }
+
+        FT_Face face{ };
+        if (FT_New_Face(library, job.font_path.c_str(), 0, &face)) {
+            return faces[key] = nullptr;
+        }
+        FT_Set_Pixel_Sizes(face, 0, job.pixel_size);
+        FT_Select_Charmap(face, ft_encoding_unicode);
+        return faces[key] = face;
+    };
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+            if (m_stopping) {
+                break;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        RasterizedGlyph glyph{ .code_point = job.code_point };
+        auto *face = face_for(job);
+
+        if (face != nullptr && FT_Load_Char(face, job.code_point, FT_LOAD_RENDER) == 0) {
+            const auto &bitmap = face->glyph->bitmap;
+            glyph.size = { static_cast<int>(bitmap.width), static_cast<int>(bitmap.rows) };
+            glyph.bearing = { face->glyph->bitmap_left, face->glyph->bitmap_top };
+            glyph.advance = face->glyph->advance.x;
+            glyph.pixels.resize(static_cast<size_t>(bitmap.width) * bitmap.rows);
+
+            for (auto row = 0u; row < bitmap.rows; ++row) {
+                std::memcpy(
+                        glyph.pixels.data() + row * bitmap.width,
+                        bitmap.buffer + static_cast<ptrdiff_t>(row) * bitmap.pitch,
+                        bitmap.width
+                );
+            }
+            glyph.ok = true;
+        }
+
+        {
+            std::lock_guard lock(job.sink->mutex);
+            job.sink->glyphs.emplace_back(std::move(glyph));
+        }
+
+        // Wake up the main loop, it may be blocked in glfwWaitEvents.
+        m_completed = true;
+        glfwPostEmptyEvent();
+    }
+
+    for (auto &[_, face] : faces) {
+        if (face != nullptr) {
+            FT_Done_Face(face);
+        }
+    }
+    FT_Done_FreeType(library);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace yui {
+
+// A glyph bitmap produced by one of the workers, tightly packed (pitch == size.x).
+struct RasterizedGlyph {
+    unsigned code_point{ 0 };
+    glm::ivec2 size{ 0, 0 };
+    glm::ivec2 bearing{ 0, 0 };
+    long advance{ 0 };
+    std::vector<uint8_t> pixels{ };
+    bool ok{ false };
+};
+
+// Where the workers hand finished glyphs to. Owned by the font and shared with the queued jobs,
+// so a font can go away while its glyphs are still being rasterized.
+struct GlyphSink {
+    std::mutex mutex{ };
+    std::vector<RasterizedGlyph> glyphs{ };
+};
+
+// Rasterizes glyphs with FreeType on a small pool of worker threads. A FT_Face may only be used
+// by one thread at a time, so every worker has its own FT_Library and opens its own faces.
+// The atlas upload stays on the GL thread, see FontResource::upload_pending().
+class GlyphRasterizer {
+public:
+    GlyphRasterizer() = default;
+    GlyphRasterizer(const GlyphRasterizer &) = delete;
+    GlyphRasterizer(GlyphRasterizer &&) = delete;
+    ~GlyphRasterizer();
+
+    // 0 picks a count based on the hardware concurrency.
+    void start(unsigned worker_count = 0);
+    void stop();
+    [[nodiscard]] bool running() const { return !m_workers.empty(); }
+    // Disabling stops the workers, fonts then rasterize on the calling thread. Glyphs that were
+    // still queued stay placeholders, so only switch before text is laid out.
+    [[nodiscard]] bool enabled() const { return m_enabled; }
+    void set_enabled(bool);
+
+    void enqueue(std::shared_ptr<GlyphSink>, std::string font_path, uint32_t pixel_size, unsigned code_point);
+
+    // True (once) when glyphs were finished since the last call.
+    bool take_completed() { return m_completed.exchange(false); }
+private:
+    struct Job {
+        std::shared_ptr<GlyphSink> sink{ };
+        std::string font_path{ };
+        uint32_t pixel_size{ 0 };
+        unsigned code_point{ 0 };
+    };
+
+    void work();
+private:
+    std::vector<std::thread> m_workers{ };
+    std::deque<Job> m_jobs{ };
+    std::mutex m_mutex{ };
+    std::condition_variable m_condition{ };
+    bool m_stopping{ false };
+    bool m_enabled{ true };
+    std::atomic<bool> m_completed{ false };
+};
+
+}
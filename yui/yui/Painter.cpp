@@ -1,8 +1,10 @@
 #include "Painter.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
+#include "ResourceLoader.h"
 #include "Util.h"
 #include "Window.h"
 #include <glm/glm.hpp>
@@ -47,6 +49,58 @@ void yui::DrawList::clear() {
     commands.clear();
     vertex_buffer.clear();
     index_buffer.clear();
+    instance_buffer.clear();
+    barrier = 0;
+}
+
+yui::DrawListMark yui::DrawList::mark() {
+    // Freeze the existing commands, otherwise push_quad could grow a command that started
+    // before the mark and the capture would miss part of it.
+    barrier = commands.size();
+    return { commands.size(), vertex_buffer.size(), index_buffer.size(), instance_buffer.size() };
+}
+
+void yui::DrawList::capture(const DrawListMark &mark, DisplayList &list) const {
+    list.clear();
+    list.commands.assign(commands.begin() + mark.commands, commands.end());
+    list.vertex_buffer.assign(vertex_buffer.begin() + mark.vertices, vertex_buffer.end());
+    list.index_buffer.reserve(index_buffer.size() - mark.indices);
+
+    for (auto i = mark.indices; i < index_buffer.size(); ++i) {
+        list.index_buffer.emplace_back(index_buffer[i] - mark.vertices);
+    }
+
+    list.instance_buffer.assign(instance_buffer.begin() + mark.instances, instance_buffer.end());
+
+    for (auto &cmd : list.commands) {
+        cmd.index -= cmd.primitive == Primitive::Quads ? mark.instances : mark.indices;
+    }
+}
+
+void yui::DrawList::append(const DisplayList &list) {
+    const auto vbo_offset = static_cast<DrawIndex>(vertex_buffer.size());
+    const auto ibo_offset = static_cast<DrawIndex>(index_buffer.size());
+
+    vertex_buffer.insert(vertex_buffer.end(), list.vertex_buffer.begin(), list.vertex_buffer.end());
+    index_buffer.reserve(index_buffer.size() + list.index_buffer.size());
+    for (const auto index : list.index_buffer) {
+        index_buffer.emplace_back(index + vbo_offset);
+    }
+
+    const auto instance_offset = static_cast<DrawIndex>(instance_buffer.size());
+    instance_buffer.insert(instance_buffer.end(), list.instance_buffer.begin(), list.instance_buffer.end());
+
+    for (auto cmd : list.commands) {
+        cmd.index += cmd.primitive == Primitive::Quads ? instance_offset : ibo_offset;
+        commands.emplace_back(cmd);
+    }
+}
+
+void yui::DisplayList::clear() {
+    commands.clear();
+    vertex_buffer.clear();
+    index_buffer.clear();
+    instance_buffer.clear();
 }
 
 yui::DrawCmd &yui::DrawList::push(
@@ -72,17 +126,119 @@ yui::DrawCmd &yui::DrawList::push(
     return commands.emplace_back(cmd);
 }
 
+yui::DrawCmd &yui::DrawList::push_quad(const Vertex (&vertices)[4], unsigned int texture_id, glm::fvec4 clip_rect) {
+    const auto vbo_offset = static_cast<DrawIndex>(vertex_buffer.size());
+    vertex_buffer.insert(vertex_buffer.end(), vertices, vertices + 4);
+
+    const DrawIndex indices[] = {
+            vbo_offset, vbo_offset + 1, vbo_offset + 2,
+            vbo_offset + 2, vbo_offset + 3, vbo_offset,
+    };
+    index_buffer.insert(index_buffer.end(), indices, indices + 6);
+
+    if (!commands.empty()) {
+        auto &last = commands.back();
+
+        if (commands.size() > barrier && last.primitive == Primitive::Triangles && last.texture_id == texture_id
+                && last.clip_rect == clip_rect && last.index + last.elements + 6 == index_buffer.size()) {
+            last.elements += 6;
+            return last;
+        }
+    }
+
+    return commands.emplace_back(
+            DrawCmd{
+                    .index = static_cast<DrawIndex>(index_buffer.size() - 6),
+                    .elements = 6,
+                    .primitive = Primitive::Triangles,
+                    .texture_id = texture_id,
+                    .clip_rect = clip_rect
+            }
+    );
+}
+
+yui::DrawCmd &yui::DrawList::push_instance(const QuadInstance &instance, unsigned int texture_id, glm::fvec4 clip_rect) {
+    instance_buffer.emplace_back(instance);
+
+    if (!commands.empty()) {
+        auto &last = commands.back();
+
+        if (commands.size() > barrier && last.primitive == Primitive::Quads && last.texture_id == texture_id
+                && last.clip_rect == clip_rect && last.index + last.elements + 1 == instance_buffer.size()) {
+            last.elements += 1;
+            return last;
+        }
+    }
+
+    return commands.emplace_back(
+            DrawCmd{
+                    .index = static_cast<DrawIndex>(instance_buffer.size() - 1),
+                    .elements = 1,
+                    .primitive = Primitive::Quads,
+                    .texture_id = texture_id,
+                    .clip_rect = clip_rect
+            }
+    );
+}
+
+static bool is_list_primitive(yui::Primitive primitive) {
+    // Strips, loops and fans can't be concatenated without changing their shape.
+    return primitive == yui::Primitive::Triangles || primitive == yui::Primitive::Lines
+            || primitive == yui::Primitive::Points || primitive == yui::Primitive::Quads;
+}
+
+static bool can_merge(const yui::DrawCmd &a, const yui::DrawCmd &b) {
+    // Untextured vertices never sample (use_sampler is per vertex), so a command without
+    // a texture can share a draw with a textured one.
+    const auto compatible_texture = a.texture_id == b.texture_id || a.texture_id == 0 || b.texture_id == 0;
+
+    return a.primitive == b.primitive && is_list_primitive(a.primitive) && compatible_texture
+            && a.clip_rect == b.clip_rect && a.index + a.elements == b.index;
+}
+
+size_t yui::DrawList::merge() {
+    const auto before = commands.size();
+
+    if (before < 2) {
+        return before;
+    }
+
+    size_t last = 0;
+    for (size_t i = 1; i < commands.size(); ++i) {
+        auto &target = commands[last];
+        const auto &cmd = commands[i];
+
+        if (can_merge(target, cmd)) {
+            target.elements += cmd.elements;
+
+            if (target.texture_id == 0) {
+                target.texture_id = cmd.texture_id;
+            }
+        } else {
+            commands[++last] = cmd;
+        }
+    }
+
+    commands.resize(last + 1);
+    return before;
+}
+
 bool yui::DrawList::empty() const {
-    return commands.empty() || vertex_buffer.empty() || index_buffer.empty();
+    return commands.empty() || ((vertex_buffer.empty() || index_buffer.empty()) && instance_buffer.empty());
 }
 
 yui::Painter::Painter(Window *window)
-        : m_window(window) {
+        : m_window(window),
+          m_vertex_stream(GL_ARRAY_BUFFER),
+          m_index_stream(GL_ELEMENT_ARRAY_BUFFER),
+          m_instance_stream(GL_ARRAY_BUFFER) {
     glEnable(GL_LINE_SMOOTH);
 }
 
 void yui::Painter::set_debug(bool v) {
     m_debug = v;
+    // The overlay has to be painted over (or removed from) the retained frame.
+    damage_all();
 }
 
 void yui::Painter::set_shader(Shader *shader) {
@@ -90,19 +246,81 @@ void yui::Painter::set_shader(Shader *shader) {
 }
 
 void yui::Painter::clear(Color c) {
+    m_draw_list.clear();
+
+    if (m_retained) {
+        // The damage isn't known until everything has been painted, render() clears it.
+        m_clear_color = c;
+        return;
+    }
+
     glClearColor(c.fr(), c.fg(), c.fb(), c.fa());
     glClear(GL_COLOR_BUFFER_BIT);
-    m_draw_list.clear();
+}
+
+void yui::Painter::set_retained(bool retained) {
+    m_retained = retained;
+    m_damage.clear();
+
+    if (retained) {
+        damage_all();
+    }
+}
+
+void yui::Painter::add_damage(glm::ivec4 rect) {
+    if (!m_retained || rect.z <= 0 || rect.w <= 0) {
+        return;
+    }
+
+    m_damage.emplace_back(rect);
+}
+
+void yui::Painter::damage_all() {
+    add_damage({ 0, 0, m_viewport.x, m_viewport.y });
+}
+
+glm::ivec4 yui::Painter::damage_bounds() const {
+    if (m_damage.empty()) {
+        return { 0, 0, 0, 0 };
+    }
+
+    glm::ivec2 min{ m_damage[0].x, m_damage[0].y };
+    glm::ivec2 max{ m_damage[0].x + m_damage[0].z, m_damage[0].y + m_damage[0].w };
+
+    for (const auto &rect : m_damage) {
+        min = glm::min(min, glm::ivec2{ rect.x, rect.y });
+        max = glm::max(max, glm::ivec2{ rect.x + rect.z, rect.y + rect.w });
+    }
+
+    min = glm::max(min, glm::ivec2{ 0, 0 });
+    max = glm::min(max, m_viewport);
+    return { min.x, min.y, max.x - min.x, max.y - min.y };
+}
+
+// Intersects two x, y, w, h rects, returns false if they don't overlap.
+static bool intersect_rects(glm::fvec4 a, glm::fvec4 b, glm::fvec4 &out) {
+    const auto left = std::max(a.x, b.x);
+    const auto top = std::max(a.y, b.y);
+    const auto right = std::min(a.x + a.z, b.x + b.z);
+    const auto bottom = std::min(a.y + a.w, b.y + b.w);
+
+    if (right <= left || bottom <= top) {
+        return false;
+    }
+
+    out = { left, top, right - left, bottom - top };
+    return true;
 }
 
 void yui::Painter::render() {
     if (debug()) {
         //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+        const auto vertex_size = m_vertex_format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
         auto vertices = yui::fmt(
                 "Vertices: %d (%d bytes / %d kb)",
                 m_draw_list.vertex_buffer.size(),
-                m_draw_list.vertex_buffer.size() * sizeof(Vertex),
-                m_draw_list.vertex_buffer.size() * sizeof(Vertex) / 1024
+                m_draw_list.vertex_buffer.size() * vertex_size,
+                m_draw_list.vertex_buffer.size() * vertex_size / 1024
         );
         auto indices = yui::fmt(
                 "Indices: %d (%d bytes / %d kb)",
@@ -119,7 +337,12 @@ void yui::Painter::render() {
 
         const auto x = static_cast<float>(m_window->width()) - max.x - (padding * 2) - spacing;
         const auto y = spacing;
-        auto draw_calls = m_draw_list.commands.size();
+        // The overlay is part of the frame it describes, so it shows the previous frame's counts.
+        auto draw_calls = yui::fmt(
+                "Draw calls: %d (%d before merge)",
+                m_stats.commands_after_merge,
+                m_stats.commands_before_merge
+        );
 
         fill_rect(
                 x,
@@ -132,68 +355,84 @@ void yui::Painter::render() {
         text(vertices, { 255, 255, 255 }, x + padding, y + 15.f);
         text(indices, { 255, 255, 255 }, x + padding, y + 15.f + padding);
         text("FPS: " + std::to_string(m_window->fps()), { 255, 255, 255 }, x + padding, y + (padding * 2) + 15.f);
-        text("Draw calls: " + std::to_string(draw_calls), { 255, 255, 255 }, x + padding, y + (padding * 3) + 15.f);
-    }
+        text(draw_calls, { 255, 255, 255 }, x + padding, y + (padding * 3) + 15.f);
 
-    if (m_draw_list.empty()) {
-        return;
+        if (m_retained) {
+            add_damage(glm::ivec4(glm::fvec4{ x, y, max.x + (padding * 2), (padding * 4) + 15.f }));
+        }
+
+        // Keep the FPS counter ticking while the window is otherwise idle.
+        m_window->request_redraw_after(1.0);
     }
 
-    if (m_shader) {
-        glUseProgram(m_shader->program_id());
-        m_shader->setMat4("ProjMtx", m_projection);
+    assign_clip_indices();
+    m_stats.commands_before_merge = m_draw_list.merge();
+    m_stats.commands_after_merge = m_draw_list.commands.size();
+
+    glm::fvec4 damage{ 0.f, 0.f, 0.f, 0.f };
+    if (m_retained) {
+        if (!has_damage()) {
+            // Nothing changed since the last frame, what's in the framebuffer is still valid.
+            return;
+        }
+
+        ensure_framebuffer();
+        damage = glm::fvec4(damage_bounds());
+
+        const auto bounds = glm::ivec4(damage);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(bounds.x, m_window->height() - bounds.y - bounds.w, bounds.z, bounds.w);
+        glClearColor(m_clear_color.fr(), m_clear_color.fg(), m_clear_color.fb(), m_clear_color.fa());
+        glClear(GL_COLOR_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+        m_frame_rendered = true;
     }
 
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    glBindBuffer(GL_ARRAY_BUFFER, m_draw_list.vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_draw_list.ibo);
+    if (m_draw_list.empty()) {
+        if (m_retained) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+        return;
+    }
 
-    // Buffer and store attributes
-    glBufferData(
-            GL_ARRAY_BUFFER,
-            sizeof(Vertex) * m_draw_list.vertex_buffer.size(),
-            &m_draw_list.vertex_buffer[0],
-            GL_STREAM_DRAW
-    );
+    const auto use_program = [this](Shader *shader) {
+        if (shader == nullptr) {
+            return;
+        }
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(
-            0, 2, GL_FLOAT, false, sizeof(Vertex),
-            reinterpret_cast<void *>(offsetof(Vertex, position))
-    );
+        glUseProgram(shader->program_id());
+        shader->setMat4("ProjMtx", m_projection);
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(
-            1, 1, GL_FLOAT, false, sizeof(Vertex),
-            reinterpret_cast<void *>(offsetof(Vertex, use_sampler))
-    );
+        if (shader == m_instanced_shader) {
+            glUniform4fv(
+                    glGetUniformLocation(shader->program_id(), "ClipRects"),
+                    static_cast<GLsizei>(m_clip_table.size()),
+                    &m_clip_table[0].x
+            );
+        }
+    };
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(
-            2, 2, GL_FLOAT, false, sizeof(Vertex),
-            reinterpret_cast<void *>(offsetof(Vertex, uv))
-    );
+    use_program(m_shader);
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(
-            3, 4, GL_FLOAT, false, sizeof(Vertex),
-            reinterpret_cast<void *>(offsetof(Vertex, color))
-    );
+    const auto offsets = upload_draw_list();
 
-    // IBO
-    glBufferData(
-            GL_ELEMENT_ARRAY_BUFFER,
-            sizeof(DrawIndex) * m_draw_list.index_buffer.size(),
-            &m_draw_list.index_buffer[0],
-            GL_STREAM_DRAW
-    );
+    setup_vertex_attributes(offsets.vertices);
 
     glActiveTexture(GL_TEXTURE0);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Only touch GL state when it actually changes between commands.
+    unsigned int bound_texture = 0;
+    auto scissor_enabled = false;
+    glm::fvec4 scissor_rect{ 0.f, 0.f, 0.f, 0.f };
+    auto instancing = false;
+
     for (auto &cmd : m_draw_list.commands) {
-        if (cmd.texture_id) {
+        if (cmd.texture_id && cmd.texture_id != bound_texture) {
             glBindTexture(GL_TEXTURE_2D, cmd.texture_id);
+            bound_texture = cmd.texture_id;
         }
 
         GLenum type = GL_TRIANGLES;
@@ -206,33 +445,82 @@ void yui::Painter::render() {
             break;
         }
 
-        auto is_clipped = false;
-        if (cmd.clip_rect != glm::fvec4(0, 0, 0, 0)) {
-            glEnable(GL_SCISSOR_TEST);
-            const auto clip_rect = glm::ivec4(cmd.clip_rect);
+        // In retained mode everything is clipped to the damaged region.
+        auto clip = cmd.clip_rect;
+        if (m_retained) {
+            if (clip == glm::fvec4(0, 0, 0, 0)) {
+                clip = damage;
+            } else if (!intersect_rects(clip, damage, clip)) {
+                continue;
+            }
+        }
+
+        const auto is_clipped = clip != glm::fvec4(0, 0, 0, 0);
+        if (is_clipped != scissor_enabled) {
+            if (is_clipped) {
+                glEnable(GL_SCISSOR_TEST);
+            } else {
+                glDisable(GL_SCISSOR_TEST);
+            }
+            scissor_enabled = is_clipped;
+        }
+
+        if (is_clipped && clip != scissor_rect) {
+            const auto clip_rect = glm::ivec4(clip);
             glScissor(
                     clip_rect.x,
                     m_window->height() - clip_rect.y - clip_rect.w,
                     clip_rect.z,
                     clip_rect.w
             );
-            is_clipped = true;
+            scissor_rect = clip;
+        }
+
+        if (cmd.primitive == Primitive::Quads) {
+            if (m_instanced_shader == nullptr) {
+                continue; // Left over from a display list recorded while instancing was enabled.
+            }
+
+            if (!instancing) {
+                use_program(m_instanced_shader);
+                instancing = true;
+            }
+
+            setup_instance_attributes(offsets.instances + cmd.index * sizeof(QuadInstance));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(cmd.elements));
+            continue;
+        }
+
+        if (instancing) {
+            use_program(m_shader);
+            setup_vertex_attributes(offsets.vertices);
+            instancing = false;
         }
 
         glDrawElements(
                 type,
                 cmd.elements,
                 GL_UNSIGNED_INT,
-                reinterpret_cast<const void *>(cmd.index * sizeof(DrawIndex))
+                reinterpret_cast<const void *>(offsets.indices + cmd.index * sizeof(DrawIndex))
         );
+    }
 
-        if (cmd.texture_id) {
-            glBindTexture(GL_TEXTURE_2D, 0);
-        }
+    if (bound_texture) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
 
-        if (is_clipped) {
-            glDisable(GL_SCISSOR_TEST);
-        }
+    if (scissor_enabled) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+
+    if (m_upload_mode == UploadMode::PersistentRing) {
+        m_vertex_stream.fence();
+        m_index_stream.fence();
+        m_instance_stream.fence();
+    }
+
+    if (m_retained) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -240,20 +528,367 @@ void yui::Painter::render() {
     glUseProgram(0);
 }
 
+yui::Painter::UploadOffsets yui::Painter::upload_draw_list() {
+    const auto compact = m_vertex_format == VertexFormat::Compact;
+    const auto vertex_count = m_draw_list.vertex_buffer.size();
+    const auto vertex_bytes = (compact ? sizeof(CompactVertex) : sizeof(Vertex)) * vertex_count;
+    const auto index_bytes = sizeof(DrawIndex) * m_draw_list.index_buffer.size();
+    const auto instance_bytes = sizeof(QuadInstance) * m_draw_list.instance_buffer.size();
+
+    if (m_upload_mode == UploadMode::PersistentRing) {
+        // Write straight into this frame's segment, no driver side allocation involved.
+        auto *vertices = m_vertex_stream.map(vertex_bytes);
+        if (compact) {
+            pack_vertices(static_cast<CompactVertex *>(vertices));
+        } else if (vertex_bytes) {
+            std::memcpy(vertices, m_draw_list.vertex_buffer.data(), vertex_bytes);
+        }
+
+        auto *indices = m_index_stream.map(index_bytes);
+        if (index_bytes) {
+            std::memcpy(indices, m_draw_list.index_buffer.data(), index_bytes);
+        }
+
+        auto *instances = m_instance_stream.map(instance_bytes);
+        if (instance_bytes) {
+            std::memcpy(instances, m_draw_list.instance_buffer.data(), instance_bytes);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_stream.buffer_id());
+        return { m_vertex_stream.offset(), m_index_stream.offset(), m_instance_stream.offset() };
+    }
+
+    // Orphan the previous storage and upload the whole frame again.
+    const void *vertices = m_draw_list.vertex_buffer.data();
+    if (compact) {
+        m_compact_staging.resize(vertex_count);
+        pack_vertices(m_compact_staging.data());
+        vertices = m_compact_staging.data();
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_draw_list.vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_draw_list.ibo);
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertices, GL_STREAM_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, m_draw_list.index_buffer.data(), GL_STREAM_DRAW);
+
+    if (instance_bytes) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instance_vbo);
+        glBufferData(GL_ARRAY_BUFFER, instance_bytes, m_draw_list.instance_buffer.data(), GL_STREAM_DRAW);
+    }
+    return { 0, 0, 0 };
+}
+
+void yui::Painter::setup_vertex_attributes(size_t vertex_offset) {
+    const auto ring = m_upload_mode == UploadMode::PersistentRing;
+    glBindBuffer(GL_ARRAY_BUFFER, ring ? m_vertex_stream.buffer_id() : m_draw_list.vbo);
+
+    // Undo the per-instance setup of the instanced path.
+    for (GLuint location = 1; location <= 3; ++location) {
+        glVertexAttribDivisor(location, 0);
+    }
+    glDisableVertexAttribArray(4);
+
+    if (m_vertex_format == VertexFormat::Compact) {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(
+                0, 2, GL_FLOAT, false, sizeof(CompactVertex),
+                reinterpret_cast<void *>(vertex_offset + offsetof(CompactVertex, position))
+        );
+
+        // The compact shader derives use_sampler from the UVs.
+        glDisableVertexAttribArray(1);
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(
+                2, 2, GL_HALF_FLOAT, false, sizeof(CompactVertex),
+                reinterpret_cast<void *>(vertex_offset + offsetof(CompactVertex, uv))
+        );
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(
+                3, 4, GL_UNSIGNED_BYTE, true, sizeof(CompactVertex),
+                reinterpret_cast<void *>(vertex_offset + offsetof(CompactVertex, color))
+        );
+        return;
+    }
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(
+            0, 2, GL_FLOAT, false, sizeof(Vertex),
+            reinterpret_cast<void *>(vertex_offset + offsetof(Vertex, position))
+    );
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(
+            1, 1, GL_FLOAT, false, sizeof(Vertex),
+            reinterpret_cast<void *>(vertex_offset + offsetof(Vertex, use_sampler))
+    );
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(
+            2, 2, GL_FLOAT, false, sizeof(Vertex),
+            reinterpret_cast<void *>(vertex_offset + offsetof(Vertex, uv))
+    );
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(
+            3, 4, GL_FLOAT, false, sizeof(Vertex),
+            reinterpret_cast<void *>(vertex_offset + offsetof(Vertex, color))
+    );
+}
+
+void yui::Painter::setup_instance_attributes(size_t instance_offset) {
+    const auto ring = m_upload_mode == UploadMode::PersistentRing;
+
+    // Corners of the unit quad, shared by every instance.
+    glBindBuffer(GL_ARRAY_BUFFER, m_unit_quad_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(float) * 2, nullptr);
+
+    glBindBuffer(GL_ARRAY_BUFFER, ring ? m_instance_stream.buffer_id() : m_instance_vbo);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(
+            1, 4, GL_FLOAT, false, sizeof(QuadInstance),
+            reinterpret_cast<void *>(instance_offset + offsetof(QuadInstance, rect))
+    );
+    glVertexAttribDivisor(1, 1);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(
+            2, 4, GL_UNSIGNED_SHORT, true, sizeof(QuadInstance),
+            reinterpret_cast<void *>(instance_offset + offsetof(QuadInstance, uv))
+    );
+    glVertexAttribDivisor(2, 1);
+
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(
+            3, 4, GL_UNSIGNED_BYTE, true, sizeof(QuadInstance),
+            reinterpret_cast<void *>(instance_offset + offsetof(QuadInstance, color))
+    );
+    glVertexAttribDivisor(3, 1);
+
+    glEnableVertexAttribArray(4);
+    glVertexAttribIPointer(
+            4, 1, GL_UNSIGNED_INT, sizeof(QuadInstance),
+            reinterpret_cast<void *>(instance_offset + offsetof(QuadInstance, flags))
+    );
+    glVertexAttribDivisor(4, 1);
+}
+
+void yui::Painter::assign_clip_indices() {
+    m_clip_table.assign(1, glm::fvec4{ 0.f, 0.f, 0.f, 0.f }); // slot 0 is "unclipped"
+
+    if (!instanced()) {
+        return;
+    }
+
+    constexpr auto clip_mask = 0xffu << QuadInstance::CLIP_SHIFT;
+    for (auto &cmd : m_draw_list.commands) {
+        if (cmd.primitive != Primitive::Quads || cmd.clip_rect == glm::fvec4(0, 0, 0, 0)) {
+            continue;
+        }
+
+        const glm::fvec4 bounds{
+                cmd.clip_rect.x,
+                cmd.clip_rect.y,
+                cmd.clip_rect.x + cmd.clip_rect.z,
+                cmd.clip_rect.y + cmd.clip_rect.w
+        };
+
+        auto it = std::find(m_clip_table.begin() + 1, m_clip_table.end(), bounds);
+        if (it == m_clip_table.end()) {
+            if (m_clip_table.size() == CLIP_TABLE_SIZE) {
+                continue; // Table is full, this command keeps using the scissor.
+            }
+            it = m_clip_table.insert(m_clip_table.end(), bounds);
+        }
+
+        const auto clip_index = static_cast<uint32_t>(it - m_clip_table.begin());
+        for (auto i = cmd.index; i < cmd.index + cmd.elements; ++i) {
+            auto &instance = m_draw_list.instance_buffer[i];
+            instance.flags = (instance.flags & ~clip_mask) | (clip_index << QuadInstance::CLIP_SHIFT);
+        }
+
+        // Clipped in the shader now, so it can be merged with its neighbours.
+        cmd.clip_rect = { 0.f, 0.f, 0.f, 0.f };
+    }
+}
+
+// IEEE 754 binary16, round to nearest. Denormals are flushed to zero, which is fine for UVs.
+static uint16_t to_half(float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const auto exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    const auto mantissa = bits & 0x7fffff;
+
+    if (exponent <= 0) {
+        return sign;
+    }
+
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+
+    // A carry out of the mantissa correctly bumps the exponent.
+    auto half = static_cast<uint32_t>(sign) | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        ++half;
+    }
+    return static_cast<uint16_t>(half);
+}
+
+static uint8_t to_unorm8(float value) {
+    return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+}
+
+void yui::Painter::pack_vertices(CompactVertex *destination) const {
+    constexpr auto untextured = 0xbc00; // -1.0 as a half float
+
+    for (const auto &vertex : m_draw_list.vertex_buffer) {
+        auto &out = *destination++;
+        out.position[0] = vertex.position[0];
+        out.position[1] = vertex.position[1];
+
+        if (vertex.use_sampler >= 1.f) {
+            out.uv[0] = to_half(vertex.uv[0]);
+            out.uv[1] = to_half(vertex.uv[1]);
+        } else {
+            out.uv[0] = out.uv[1] = untextured;
+        }
+
+        for (auto i = 0; i < 4; ++i) {
+            out.color[i] = to_unorm8(vertex.color[i]);
+        }
+    }
+}
+
 void yui::Painter::present() {
+    if (m_retained) {
+        if (!m_frame_rendered) {
+            return; // The front buffer is still up to date.
+        }
+
+        // The back buffer is undefined after a swap, so the whole retained frame is copied over.
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(
+                0, 0, m_framebuffer_size.x, m_framebuffer_size.y,
+                0, 0, m_framebuffer_size.x, m_framebuffer_size.y,
+                GL_COLOR_BUFFER_BIT,
+                GL_NEAREST
+        );
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        m_damage.clear();
+        m_frame_rendered = false;
+    }
+
     glfwSwapBuffers(m_window->glfw_window());
 }
 
+void yui::Painter::ensure_framebuffer() {
+    if (m_framebuffer != 0 && m_framebuffer_size == m_viewport) {
+        return;
+    }
+
+    delete_framebuffer();
+
+    glGenTextures(1, &m_framebuffer_texture);
+    glBindTexture(GL_TEXTURE_2D, m_framebuffer_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_viewport.x, m_viewport.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_framebuffer_texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        Application::the().report_error("Retained framebuffer is incomplete");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    m_framebuffer_size = m_viewport;
+
+    // A new framebuffer has no content yet.
+    m_damage.clear();
+    damage_all();
+}
+
+void yui::Painter::delete_framebuffer() {
+    if (m_framebuffer != 0) {
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteTextures(1, &m_framebuffer_texture);
+    }
+
+    m_framebuffer = m_framebuffer_texture = 0;
+    m_framebuffer_size = { 0, 0 };
+}
+
 void yui::Painter::create_buffers() {
     // Create and setup VBO
     glGenBuffers(1, &m_draw_list.vbo);
     glGenBuffers(1, &m_draw_list.ibo);
+    glGenBuffers(1, &m_instance_vbo);
+
+    // Triangle strip order
+    const float unit_quad[] = {
+            0.f, 0.f,
+            1.f, 0.f,
+            0.f, 1.f,
+            1.f, 1.f,
+    };
+    glGenBuffers(1, &m_unit_quad_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_unit_quad_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unit_quad), unit_quad, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (m_upload_mode == UploadMode::PersistentRing) {
+        if (!StreamBuffer::supported()) {
+            spdlog::warn("Persistent buffer mapping is not supported, falling back to buffer orphaning");
+            m_upload_mode = UploadMode::Orphaning;
+            return;
+        }
+
+        m_vertex_stream.create(INITIAL_VERTEX_SEGMENT_SIZE);
+        m_index_stream.create(INITIAL_INDEX_SEGMENT_SIZE);
+        m_instance_stream.create(INITIAL_INSTANCE_SEGMENT_SIZE);
+    }
 }
 
 void yui::Painter::delete_buffers() {
     // Delete the buffers
     glDeleteBuffers(1, &m_draw_list.vbo);
     glDeleteBuffers(1, &m_draw_list.ibo);
+    glDeleteBuffers(1, &m_instance_vbo);
+    glDeleteBuffers(1, &m_unit_quad_vbo);
+    m_draw_list.vbo = m_draw_list.ibo = 0;
+    m_instance_vbo = m_unit_quad_vbo = 0;
+    m_vertex_stream.destroy();
+    m_index_stream.destroy();
+    m_instance_stream.destroy();
+    delete_framebuffer();
+}
+
+void yui::Painter::set_upload_mode(UploadMode mode) {
+    if (mode == m_upload_mode) {
+        return;
+    }
+
+    const auto had_buffers = m_draw_list.vbo != 0;
+    if (had_buffers) {
+        delete_buffers();
+    }
+
+    m_upload_mode = mode;
+
+    if (had_buffers) {
+        create_buffers();
+    }
 }
 
 void yui::Painter::set_gl_color(const Color &c) {
@@ -264,7 +899,13 @@ void yui::Painter::setup_viewport(int w, int h) {
     // set up view
     glViewport(0, 0, w, h);
     m_projection = glm::ortho(0.0f, static_cast<float>(w), static_cast<float>(h), 0.0f);
+
+    const auto resized = m_viewport != glm::ivec2{ w, h };
     m_viewport = { w, h };
+
+    if (m_retained && resized) {
+        damage_all();
+    }
 }
 
 glm::ivec2 yui::Painter::text_size(const std::string_view &s) {
@@ -279,7 +920,7 @@ glm::ivec2 yui::Painter::text_size(const std::string_view &s) {
 }
 
 glm::ivec2 yui::Painter::text_size(const std::string_view &s, FontResource &f) {
-    return f.text_size(s, { *this });
+    return { m_shaping_cache.shape(s, f).width, f.line_height() };
 }
 
 glm::ivec2 yui::Painter::text_size(const Utf8String &view) {
@@ -294,7 +935,7 @@ glm::ivec2 yui::Painter::text_size(const Utf8String &view) {
 }
 
 glm::ivec2 yui::Painter::text_size(const Utf8String &view, FontResource &f) {
-    return f.text_size(view, { *this });
+    return { m_shaping_cache.shape(view, f).width, f.line_height() };
 }
 
 void yui::Painter::text(const std::string_view &s, const Color &color, float x, float y, glm::fvec4 clip_rect) {
@@ -350,89 +991,7 @@ void yui::Painter::text(
         FontResource &font,
         glm::fvec4 clip_rect
 ) {
-    // TODO: We need to optimize this to become one single draw call instead of a draw call
-    // per character. This is currently going to be incredibly inefficient with huge chunks
-    // of texts (which often appear in UIs).
-    auto y_max = font.character('|')->size.y;
-
-    for (const auto info : view) {
-        auto *ch = font.character(info.code_point);
-
-        if (ch == nullptr) {
-            continue;
-        }
-
-        auto xpos = x + static_cast<float>(ch->bearing.x);
-        auto ypos = y + (y_max - static_cast<float>(ch->bearing.y));
-        auto w = ch->size.x;
-        auto h = ch->size.y;
-
-        Vertex vertices[] = {
-                {
-                        .position = { xpos, ypos + h }, .use_sampler=1, .uv={ 0.0f, 1.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos + w, ypos }, .use_sampler=1, .uv={ 1.0f, 0.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos, ypos }, .use_sampler=1, .uv={ 0.0f, 0.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-
-                {
-                        .position = { xpos, ypos + h }, .use_sampler=1, .uv={ 0.0f, 1.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos + w, ypos + h }, .use_sampler=1, .uv={ 1.0f, 1.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos + w, ypos }, .use_sampler=1, .uv={ 1.0f, 0.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-        };
-
-        DrawIndex indices[] = {
-                0, 1, 2,
-                3, 4, 5
-        };
-
-        auto &cmd = m_draw_list.push(vertices, indices);
-        cmd.texture_id = ch->texture_id;
-
-        if (clip_rect != glm::fvec4{ 0.f, 0.f, 0.f, 0.f }) {
-            cmd.clip_rect = clip_rect;
-        }
-
-        x += ch->advance >> 6;
-    }
+    push_glyphs(view, color, x, y, font, clip_rect);
 }
 
 void yui::Painter::text(
@@ -443,89 +1002,7 @@ void yui::Painter::text(
         FontResource &font,
         glm::fvec4 clip_rect
 ) {
-    // TODO: We need to optimize this to become one single draw call instead of a draw call
-    // per character. This is currently going to be incredibly inefficient with huge chunks
-    // of texts (which often appear in UIs).
-    auto y_max = font.character('|')->size.y;
-
-    for (const auto &c : s) {
-        auto *ch = font.character(c);
-
-        if (ch == nullptr) {
-            continue;
-        }
-
-        auto xpos = x + static_cast<float>(ch->bearing.x);
-        auto ypos = y + (y_max - static_cast<float>(ch->bearing.y));
-        auto w = ch->size.x;
-        auto h = ch->size.y;
-
-        Vertex vertices[] = {
-                {
-                        .position = { xpos, ypos + h }, .use_sampler=1, .uv={ 0.0f, 1.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos + w, ypos }, .use_sampler=1, .uv={ 1.0f, 0.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos, ypos }, .use_sampler=1, .uv={ 0.0f, 0.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-
-                {
-                        .position = { xpos, ypos + h }, .use_sampler=1, .uv={ 0.0f, 1.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos + w, ypos + h }, .use_sampler=1, .uv={ 1.0f, 1.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-                {
-                        .position = { xpos + w, ypos }, .use_sampler=1, .uv={ 1.0f, 0.0f }, .color= {
-                        color.fr(),
-                        color.fg(),
-                        color.fb(),
-                        color.fa()
-                }
-                },
-        };
-
-        DrawIndex indices[] = {
-                0, 1, 2,
-                3, 4, 5
-        };
-
-        auto &cmd = m_draw_list.push(vertices, indices);
-        cmd.texture_id = ch->texture_id;
-
-        if (clip_rect != glm::fvec4{ 0.f, 0.f, 0.f, 0.f }) {
-            cmd.clip_rect = clip_rect;
-        }
-
-        x += ch->advance >> 6;
-    }
+    push_glyphs(s, color, x, y, font, clip_rect);
 }
 
 void yui::Painter::text(
@@ -540,6 +1017,11 @@ void yui::Painter::text(
 }
 
 void yui::Painter::fill_rect(float x, float y, float w, float h, const Color &color, glm::fvec4 clip_rect) {
+    if (instanced()) {
+        push_rect_instance(x, y, w, h, color, clip_rect);
+        return;
+    }
+
     Vertex vertices[] = {
             { .position = { x, y + h }, .use_sampler=0, .color= { color.fr(), color.fg(), color.fb(), color.fa() } },
             {
@@ -559,7 +1041,11 @@ void yui::Painter::fill_rect(float x, float y, float w, float h, const Color &co
             2, 3, 0,
     };
 
-    m_draw_list.push(vertices, indices);
+    auto &cmd = m_draw_list.push(vertices, indices);
+
+    if (clip_rect != glm::fvec4{ 0.f, 0.f, 0.f, 0.f }) {
+        cmd.clip_rect = clip_rect;
+    }
 }
 
 void yui::Painter::fill_rect(int x, int y, int w, int h, const Color &color, glm::fvec4 clip_rect) {
@@ -582,6 +1068,22 @@ void yui::Painter::outline_rect(
         float thickness,
         glm::fvec4 clip_rect
 ) {
+    if (instanced()) {
+        // Same coverage as the vertex geometry below, as four rects.
+        if (thickness > 1.0f) {
+            push_rect_instance(x, y, w + thickness, thickness, color, clip_rect); // top
+            push_rect_instance(x, y + thickness, thickness, h + thickness, color, clip_rect); // left
+            push_rect_instance(x, y + h + thickness, w + thickness * 2, thickness, color, clip_rect); // bottom
+            push_rect_instance(x + w + thickness, y, thickness, h + thickness * 2, color, clip_rect); // right
+        } else {
+            push_rect_instance(x, y, w, 1.f, color, clip_rect); // top
+            push_rect_instance(x, y, 1.f, h, color, clip_rect); // left
+            push_rect_instance(x, y + h, w + 1.f, 1.f, color, clip_rect); // bottom
+            push_rect_instance(x + w, y, 1.f, h, color, clip_rect); // right
+        }
+        return;
+    }
+
     if (thickness > 1.0f) {
         auto x1 = x;
         auto x2 = x + w + thickness;
@@ -761,6 +1263,14 @@ void yui::Painter::outline_rect(int x, int y, int w, int h, const Color &color,
     );
 }
 
+void yui::Painter::push_rect_instance(float x, float y, float w, float h, const Color &color, glm::fvec4 clip_rect) {
+    const QuadInstance instance{
+            .rect = { x, y, w, h },
+            .color = { color.r, color.g, color.b, color.a },
+    };
+    m_draw_list.push_instance(instance, 0, clip_rect);
+}
+
 void yui::Painter::line(float x1, float y1, float x2, float y2, const Color &color) {
     Vertex vertices[] = {
             { .position = { x1, y1 }, .color={ color.fr(), color.fg(), color.fb(), color.fa() } },
@@ -774,6 +1284,69 @@ void yui::Painter::line(int x1, int y1, int x2, int y2, const Color &c) {
     line(static_cast<float>(x1), static_cast<float>(y1), static_cast<float>(x2), static_cast<float>(y2), c);
 }
 
+static uint16_t to_unorm16(float value) {
+    return static_cast<uint16_t>(std::clamp(value, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+template<typename String>
+void yui::Painter::push_glyphs(
+        const String &string,
+        const Color &color,
+        float x,
+        float y,
+        FontResource &font,
+        glm::fvec4 clip_rect
+) {
+    // Every glyph lives in an atlas page, so consecutive glyphs extend the same draw command
+    // and the whole string (usually) ends up as a single draw call.
+    const auto y_max = static_cast<float>(font.line_height());
+    const float vertex_color[4] = { color.fr(), color.fg(), color.fb(), color.fa() };
+    const auto &run = m_shaping_cache.shape(string, font);
+
+    for (const auto &[ch, pen] : run.glyphs) {
+        const auto xpos = x + static_cast<float>(pen + ch->bearing.x);
+        const auto ypos = y + (y_max - static_cast<float>(ch->bearing.y));
+        const auto w = static_cast<float>(ch->size.x);
+        const auto h = static_cast<float>(ch->size.y);
+
+        // Not rasterized yet, hint at the glyph until the next frame picks it up.
+        if (ch->pending) {
+            fill_rect(xpos, ypos, w, h, color.with_a(static_cast<uint32_t>(color.a / 4)), clip_rect);
+            continue;
+        }
+
+        if (ch->texture_id == 0) {
+            continue;
+        }
+
+        const auto &uv = ch->uv;
+
+        if (instanced()) {
+            const QuadInstance instance{
+                    .rect = { xpos, ypos, w, h },
+                    .uv = { to_unorm16(uv.x), to_unorm16(uv.y), to_unorm16(uv.z), to_unorm16(uv.w) },
+                    .color = { color.r, color.g, color.b, color.a },
+                    .flags = QuadInstance::TEXTURED
+            };
+            m_draw_list.push_instance(instance, ch->texture_id, clip_rect);
+            continue;
+        }
+
+        Vertex vertices[4] = {
+                { .position = { xpos, ypos }, .use_sampler=1, .uv={ uv.x, uv.y } },
+                { .position = { xpos + w, ypos }, .use_sampler=1, .uv={ uv.z, uv.y } },
+                { .position = { xpos + w, ypos + h }, .use_sampler=1, .uv={ uv.z, uv.w } },
+                { .position = { xpos, ypos + h }, .use_sampler=1, .uv={ uv.x, uv.w } },
+        };
+
+        for (auto &vertex : vertices) {
+            std::copy(std::begin(vertex_color), std::end(vertex_color), vertex.color);
+        }
+
+        m_draw_list.push_quad(vertices, ch->texture_id, clip_rect);
+    }
+}
+
 void yui::Painter::make_context() {
     glfwMakeContextCurrent(m_window->glfw_window());
 }
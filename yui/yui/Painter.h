@@ -1,8 +1,11 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 #include <glm/glm.hpp>
+#include "ShapingCache.h"
+#include "StreamBuffer.h"
 #include "Utf8String.h"
 
 namespace yui {
@@ -47,6 +50,24 @@ struct Vertex {
     float color[4]{ };
 };
 
+// 16 bytes instead of 36. There is no use_sampler, untextured vertices have negative UVs.
+struct CompactVertex {
+    float position[2]{ };
+    uint16_t uv[2]{ }; // half floats
+    uint8_t color[4]{ }; // RGBA8, normalized by GL
+};
+
+// One rect or glyph of the instanced path, a unit quad is stretched over it in the vertex shader.
+struct QuadInstance {
+    static constexpr uint32_t TEXTURED = 1u;
+    static constexpr uint32_t CLIP_SHIFT = 8u; // bits 8-15 index the clip table, 0 is unclipped
+
+    float rect[4]{ }; // x, y, width, height
+    uint16_t uv[4]{ }; // u0, v0, u1, v1 as unorm16
+    uint8_t color[4]{ }; // RGBA8
+    uint32_t flags{ 0 };
+};
+
 enum class Primitive {
     Triangles,
     Points,
@@ -56,7 +77,7 @@ enum class Primitive {
     Polygon,
     TriangleStrip,
     TriangleFan,
-    Quads,
+    Quads, // instanced, index and elements refer to DrawList::instance_buffer
     QuadStrip,
 };
 
@@ -68,14 +89,42 @@ struct DrawCmd {
     glm::fvec4 clip_rect{ 0.f, 0.f, 0.f, 0.f };
 };
 
+// A slice of a DrawList captured for later re-use, indices are relative to its own vertices.
+struct DisplayList {
+    std::vector<DrawCmd> commands{ };
+    std::vector<Vertex> vertex_buffer{ };
+    std::vector<DrawIndex> index_buffer{ };
+    std::vector<QuadInstance> instance_buffer{ };
+
+    void clear();
+    [[nodiscard]] bool empty() const { return commands.empty(); }
+};
+
+struct DrawListMark {
+    size_t commands{ 0 };
+    size_t vertices{ 0 };
+    size_t indices{ 0 };
+    size_t instances{ 0 };
+};
+
 struct DrawList {
     std::vector<DrawCmd> commands{ };
     std::vector<Vertex> vertex_buffer{ };
     std::vector<DrawIndex> index_buffer{ };
+    std::vector<QuadInstance> instance_buffer{ };
     unsigned int vbo{ 0 }, ibo{ 0 };
+    // Commands before this index are never extended by push_quad (see mark()).
+    size_t barrier{ 0 };
 
     void clear();
 
+    // Remembers the current end of the list, everything pushed after it can be captured.
+    DrawListMark mark();
+    // Copies everything pushed since the mark into the display list.
+    void capture(const DrawListMark &, DisplayList &) const;
+    // Re-emits a previously captured display list.
+    void append(const DisplayList &);
+
     template<size_t v_size, size_t i_size>
     DrawCmd &push(Vertex (&vertices)[v_size], DrawIndex (&indices)[i_size], Primitive prim = Primitive::Triangles) {
         return push(vertices, v_size, indices, i_size, prim);
@@ -88,10 +137,45 @@ struct DrawList {
             size_t indices_count,
             Primitive prim = Primitive::Triangles
     );
+
+    // Pushes a textured quad (top-left, top-right, bottom-right, bottom-left), extending the
+    // last command instead of creating a new one when it uses the same texture and clip rect.
+    DrawCmd &push_quad(const Vertex (&vertices)[4], unsigned int texture_id, glm::fvec4 clip_rect = { });
+    // Same as push_quad but for the instanced path, the last Quads command is extended when possible.
+    DrawCmd &push_instance(const QuadInstance &, unsigned int texture_id, glm::fvec4 clip_rect = { });
+
+    // Coalesces adjacent commands that share primitive, texture and clip rect (and whose
+    // index ranges are contiguous) into a single ranged draw. Returns the command count
+    // before merging.
+    size_t merge();
     [[nodiscard]] bool empty() const;
 };
 
+struct DrawStats {
+    size_t commands_before_merge{ 0 };
+    size_t commands_after_merge{ 0 };
+};
+
+// How the draw list is handed over to the GPU every frame.
+enum class UploadMode {
+    Orphaning, // glBufferData on the whole draw list, works everywhere
+    PersistentRing, // triple buffered persistently mapped ring, requires GL 4.4 / ARB_buffer_storage
+};
+
+// Layout of the vertices handed to GL. The shader has to match (basic.vert / basic-compact.vert).
+enum class VertexFormat {
+    Full, // yui::Vertex
+    Compact, // yui::CompactVertex, packed at upload time
+};
+
 class Painter {
+public:
+    static constexpr size_t INITIAL_VERTEX_SEGMENT_SIZE = 1024 * 1024;
+    static constexpr size_t INITIAL_INDEX_SEGMENT_SIZE = 256 * 1024;
+    static constexpr size_t INITIAL_INSTANCE_SEGMENT_SIZE = 256 * 1024;
+    // Must match the ClipRects array in quad-instanced.vert.
+    static constexpr size_t CLIP_TABLE_SIZE = 64;
+
 public:
     explicit Painter(Window *);
     Painter(const Painter &) = delete;
@@ -103,12 +187,40 @@ public:
     void set_debug(bool v);
     [[nodiscard]] Shader *shader() const { return m_shader; }
     void set_shader(Shader *);
+    [[nodiscard]] UploadMode upload_mode() const { return m_upload_mode; }
+    // Falls back to Orphaning on create_buffers() when the ring isn't supported. Re-creates
+    // the buffers if they already exist, so the painter's context must be current.
+    void set_upload_mode(UploadMode);
+    [[nodiscard]] VertexFormat vertex_format() const { return m_vertex_format; }
+    void set_vertex_format(VertexFormat format) { m_vertex_format = format; }
+    // When set, rects and glyphs are emitted as one QuadInstance each and drawn with this
+    // shader (quad-instanced.vert / .frag). nullptr goes back to plain vertices. Both paths honor
+    // clip_rect: instances through the clip table, vertices through a scissor per command.
+    [[nodiscard]] Shader *instanced_shader() const { return m_instanced_shader; }
+    void set_instanced_shader(Shader *shader) { m_instanced_shader = shader; }
+    [[nodiscard]] bool instanced() const { return m_instanced_shader != nullptr; }
 
     virtual void clear(Color); // clears screen with Color
     virtual void render(); // renders the current draw list
     virtual void setup_viewport(int w, int h);
 
     [[nodiscard]] glm::ivec2 viewport() const { return m_viewport; }
+    [[nodiscard]] const DrawStats &last_frame_stats() const { return m_stats; }
+    [[nodiscard]] DrawList &draw_list() { return m_draw_list; }
+
+    // In retained mode the frame is kept in an offscreen framebuffer and only the damaged
+    // region is cleared and re-rasterized. Frames without damage are neither rendered nor presented.
+    [[nodiscard]] bool retained() const { return m_retained; }
+    void set_retained(bool);
+
+    // Damage rects are x, y, width, height in window coordinates.
+    void add_damage(glm::ivec4 rect);
+    void damage_all();
+    [[nodiscard]] bool has_damage() const { return !m_damage.empty(); }
+    [[nodiscard]] glm::ivec4 damage_bounds() const;
+
+    // Measured and drawn text goes through this, see ShapingCache.
+    [[nodiscard]] ShapingCache &shaping_cache() { return m_shaping_cache; }
 
     // Utility
     glm::ivec2 text_size(const std::string_view &);
@@ -150,6 +262,25 @@ public:
     void delete_buffers();
 private:
     void set_gl_color(const Color &);
+    struct UploadOffsets {
+        size_t vertices{ 0 };
+        size_t indices{ 0 };
+        size_t instances{ 0 };
+    };
+
+    // Uploads vertices, indices and instances and returns their byte offsets.
+    UploadOffsets upload_draw_list();
+    void setup_vertex_attributes(size_t vertex_offset);
+    void setup_instance_attributes(size_t instance_offset);
+    // Moves clip rects of instanced commands into the clip table so they can be merged.
+    void assign_clip_indices();
+    void push_rect_instance(float x, float y, float w, float h, const Color &, glm::fvec4 clip_rect);
+    void pack_vertices(CompactVertex *destination) const;
+    void ensure_framebuffer();
+    void delete_framebuffer();
+
+    template<typename String>
+    void push_glyphs(const String &, const Color &, float x, float y, FontResource &, glm::fvec4 clip_rect);
 private:
     Window *m_window;
     glm::mat4 m_projection{ };
@@ -157,6 +288,29 @@ private:
     Shader *m_shader{ };
     bool m_debug{ false };
     glm::ivec2 m_viewport{ 0, 0 };
+    DrawStats m_stats{ };
+    ShapingCache m_shaping_cache{ };
+    UploadMode m_upload_mode{ UploadMode::PersistentRing };
+    VertexFormat m_vertex_format{ VertexFormat::Full };
+    std::vector<CompactVertex> m_compact_staging{ }; // Only used when orphaning
+    StreamBuffer m_vertex_stream;
+    StreamBuffer m_index_stream;
+
+    // Instanced path
+    Shader *m_instanced_shader{ nullptr };
+    StreamBuffer m_instance_stream;
+    unsigned int m_instance_vbo{ 0 };
+    unsigned int m_unit_quad_vbo{ 0 };
+    std::vector<glm::fvec4> m_clip_table{ };
+
+    // Retained mode
+    bool m_retained{ false };
+    bool m_frame_rendered{ false };
+    Color m_clear_color{ };
+    std::vector<glm::ivec4> m_damage{ };
+    unsigned int m_framebuffer{ 0 };
+    unsigned int m_framebuffer_texture{ 0 };
+    glm::ivec2 m_framebuffer_size{ 0, 0 };
 };
 
 }
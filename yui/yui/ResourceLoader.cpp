@@ -6,62 +6,92 @@
 #include "Window.h"
 #include "Utf8String.h"
 
-yui::FontResource::FontResource(FT_Face face, std::string path, uint32_t pixel_size)
-        : m_face(face), m_font_path(std::move(path)), m_pixel_size(pixel_size) {
+yui::FontResource::FontResource(FT_Face face, std::string path, uint32_t pixel_size, GlyphAtlas &atlas)
+        : m_face(face), m_font_path(std::move(path)), m_pixel_size(pixel_size), m_atlas(atlas) {
 }
 
 yui::FontResource::~FontResource() {
+    // The textures are atlas pages, owned by the GlyphAtlas.
     FT_Done_Face(m_face);
 
-    for (auto [_, texture] : m_textures) {
-        glDeleteTextures(1, &texture->texture_id);
-        delete texture;
-    }
-
     spdlog::info("Deleted font face ('{}', {}px)", m_font_path, m_pixel_size);
 }
 
-glm::ivec2 yui::FontResource::text_size(const std::string_view &text, Badge<Painter> badge) {
-    glm::ivec2 size{ 0, 0 };
-    for (auto &c : text) {
-        auto *ch = character(c);
+yui::FontResource::CharacterTex *yui::FontResource::find(unsigned code_point) {
+    if (code_point < BMP_SIZE) {
+        auto *block = m_blocks[code_point >> BLOCK_SHIFT].get();
+        return block != nullptr && block->present[code_point & BLOCK_MASK]
+               ? &block->glyphs[code_point & BLOCK_MASK]
+               : nullptr;
+    }
 
-        if (ch == nullptr) {
-            continue;
-        }
+    const auto it = m_overflow.find(code_point);
+    return it != m_overflow.end() ? &it->second : nullptr;
+}
 
-        size.x += ch->advance >> 6;
+yui::FontResource::CharacterTex &yui::FontResource::emplace(unsigned code_point, const CharacterTex &tex) {
+    if (code_point >= BMP_SIZE) {
+        return m_overflow[code_point] = tex;
     }
 
-    size.y = character('|')->size.y;
+    auto &block = m_blocks[code_point >> BLOCK_SHIFT];
+    if (block == nullptr) {
+        block = std::make_unique<GlyphBlock>();
+    }
 
-    return size;
+    block->present.set(code_point & BLOCK_MASK);
+    return block->glyphs[code_point & BLOCK_MASK] = tex;
 }
 
-glm::ivec2 yui::FontResource::text_size(const Utf8String &view, Badge<Painter>) {
-    glm::ivec2 size{ 0, 0 };
-    for (const auto &info : view) {
-        auto *ch = character(info.code_point);
-
-        if (ch == nullptr) {
+template<typename Callable>
+void yui::FontResource::for_each_glyph(Callable &&callable) {
+    for (auto i = 0u; i < m_blocks.size(); ++i) {
+        if (m_blocks[i] == nullptr) {
             continue;
         }
 
-        size.x += ch->advance >> 6;
+        for (auto j = 0u; j < BLOCK_SIZE; ++j) {
+            if (m_blocks[i]->present[j]) {
+                callable((i << BLOCK_SHIFT) | j, m_blocks[i]->glyphs[j]);
+            }
+        }
     }
 
-    size.y = character('|')->size.y;
-    return size;
+    for (auto &[code_point, tex] : m_overflow) {
+        callable(code_point, tex);
+    }
 }
 
-yui::FontResource::CharacterTex *yui::FontResource::character(unsigned code_point) {
-    const auto it = m_textures.find(code_point);
+yui::FontResource::CharacterTex *yui::FontResource::load_character(unsigned code_point) {
+    FT_Select_Charmap(m_face, ft_encoding_unicode);
+
+    auto &rasterizer = Application::the().glyph_rasterizer();
+    if (rasterizer.enabled()) {
+        // Only load the outline metrics here, layout needs the advance right away.
+        // The bitmap is rendered by a worker and uploaded in upload_pending().
+        if (FT_Load_Char(m_face, code_point, FT_LOAD_DEFAULT)) {
+            Application::the().report_error("Could not load code point in FontResource::character()");
+            return nullptr;
+        }
 
-    if (it != m_textures.end()) {
-        return it->second;
+        const auto &metrics = m_face->glyph->metrics;
+        const auto size = glm::ivec2((metrics.width + 63) >> 6, (metrics.height + 63) >> 6);
+        auto &tex = emplace(code_point, CharacterTex{
+                .texture_id = 0,
+                .size = size,
+                .bearing = glm::ivec2(metrics.horiBearingX >> 6, (metrics.horiBearingY + 63) >> 6),
+                .advance = m_face->glyph->advance.x,
+                .uv = { },
+                .pending = size.x > 0 && size.y > 0
+        });
+
+        if (tex.pending) {
+            rasterizer.start();
+            rasterizer.enqueue(m_sink, m_font_path, m_pixel_size, code_point);
+        }
+        return &tex;
     }
 
-    FT_Select_Charmap(m_face, ft_encoding_unicode);
     // create it.
     auto error = FT_Load_Char(m_face, code_point, FT_LOAD_RENDER);
 
@@ -70,44 +100,150 @@ yui::FontResource::CharacterTex *yui::FontResource::character(unsigned code_poin
         return nullptr;
     }
 
-    GLuint texture = 0u;
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-    // Generate texture
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,//GL_BGRA_EXT,
-            m_face->glyph->bitmap.width,
-            m_face->glyph->bitmap.rows,
-            0,
-            GL_RED,//GL_BGRA_EXT,
-            GL_UNSIGNED_BYTE,
-            m_face->glyph->bitmap.buffer
+    const auto &bitmap = m_face->glyph->bitmap;
+    const auto region = m_atlas.insert(
+            static_cast<int>(bitmap.width),
+            static_cast<int>(bitmap.rows),
+            bitmap.buffer,
+            bitmap.pitch
     );
-    // set texture options
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindTexture(GL_TEXTURE_2D, 0);
-    auto *tex = new CharacterTex{
-            .texture_id = texture,
-            .size = glm::ivec2(m_face->glyph->bitmap.width, m_face->glyph->bitmap.rows),
+
+    auto &tex = emplace(code_point, CharacterTex{
+            .texture_id = region.texture_id,
+            .size = glm::ivec2(bitmap.width, bitmap.rows),
             .bearing = glm::ivec2(m_face->glyph->bitmap_left, m_face->glyph->bitmap_top),
-            .advance = m_face->glyph->advance.x
-    };
+            .advance = m_face->glyph->advance.x,
+            .uv = region.uv,
+            .atlas_position = region.position
+    });
+    m_glyph_cache_dirty = true;
     spdlog::debug(
             "Loaded glyph '{}' from ('{}', {})",
             yui::escape_code_point(Utf8String::decode(code_point).value_or({ })),
             m_font_path,
             m_pixel_size
     );
-    return m_textures[code_point] = tex;
+    return &tex;
+}
+
+bool yui::FontResource::upload_pending() {
+    std::vector<RasterizedGlyph> glyphs{ };
+    {
+        std::lock_guard lock(m_sink->mutex);
+        glyphs.swap(m_sink->glyphs);
+    }
+
+    // All glyphs that finished since the last frame go into the atlas in one go.
+    for (const auto &glyph : glyphs) {
+        auto *tex = find(glyph.code_point);
+
+        if (tex == nullptr) {
+            continue;
+        }
+
+        tex->pending = false;
+        m_glyph_cache_dirty = true;
+
+        if (!glyph.ok) {
+            spdlog::warn("Could not rasterize code point {} of ('{}', {})", glyph.code_point, m_font_path, m_pixel_size);
+            continue;
+        }
+
+        const auto region = m_atlas.insert(glyph.size.x, glyph.size.y, glyph.pixels.data(), glyph.size.x);
+        tex->texture_id = region.texture_id;
+        tex->size = glyph.size;
+        tex->bearing = glyph.bearing;
+        tex->advance = glyph.advance;
+        tex->uv = region.uv;
+        tex->atlas_position = region.position;
+    }
+
+    return !glyphs.empty();
+}
+
+bool yui::FontResource::load_glyph_cache(const std::string &directory) {
+    if (m_font_hash == 0) {
+        m_font_hash = GlyphCacheFile::hash_font(m_font_path);
+    }
+
+    GlyphCacheFile file{ };
+    if (!file.open(GlyphCacheFile::path_for(directory, m_font_path, m_pixel_size), m_font_hash, m_pixel_size)) {
+        return false;
+    }
+
+    // The bitmaps go straight from the mapping into the atlas.
+    for (size_t i = 0; i < file.glyph_count(); ++i) {
+        const auto glyph = file.glyph(i);
+
+        if (find(glyph.code_point) != nullptr) {
+            continue;
+        }
+
+        const auto region = m_atlas.insert(glyph.size.x, glyph.size.y, glyph.pixels, glyph.size.x);
+        emplace(glyph.code_point, CharacterTex{
+                .texture_id = region.texture_id,
+                .size = glyph.size,
+                .bearing = glyph.bearing,
+                .advance = glyph.advance,
+                .uv = region.uv,
+                .atlas_position = region.position
+        });
+    }
+
+    spdlog::info("Loaded {} glyphs of ('{}', {}px) from the glyph cache", file.glyph_count(), m_font_path, m_pixel_size);
+    return true;
+}
+
+bool yui::FontResource::save_glyph_cache(const std::string &directory) {
+    if (m_font_hash == 0) {
+        m_font_hash = GlyphCacheFile::hash_font(m_font_path);
+    }
+
+    if (m_font_hash == 0) {
+        return false;
+    }
+
+    std::vector<GlyphCacheEntry> entries{ };
+    std::vector<uint8_t> pixels{ };
+    std::vector<size_t> offsets{ };
+
+    for_each_glyph([&](unsigned code_point, const CharacterTex &tex) {
+        // Whatever is still in flight gets rasterized again next time.
+        if (tex.pending) {
+            return;
+        }
+
+        const auto size = tex.texture_id != 0 ? tex.size : glm::ivec2{ 0, 0 };
+        offsets.emplace_back(pixels.size());
+        pixels.resize(pixels.size() + static_cast<size_t>(size.x) * size.y);
+
+        if (size.x > 0 && !m_atlas.read(tex.texture_id, tex.atlas_position, size, pixels.data() + offsets.back())) {
+            pixels.resize(offsets.back());
+            offsets.pop_back();
+            return;
+        }
+
+        entries.emplace_back(GlyphCacheEntry{
+                .code_point = code_point,
+                .size = size,
+                .bearing = tex.bearing,
+                .advance = tex.advance
+        });
+    });
+
+    // Pointers only once the pixel buffer stopped growing.
+    for (size_t i = 0; i < entries.size(); ++i) {
+        entries[i].pixels = pixels.data() + offsets[i];
+    }
+
+    const auto path = GlyphCacheFile::path_for(directory, m_font_path, m_pixel_size);
+    if (!GlyphCacheFile::write(path, m_font_hash, m_pixel_size, entries)) {
+        return false;
+    }
+
+    m_glyph_cache_dirty = false;
+    spdlog::info("Saved {} glyphs of ('{}', {}px) to '{}'", entries.size(), m_font_path, m_pixel_size, path);
+    return true;
 }
 
 void yui::FontResource::set_font_size(uint32_t size) {
@@ -218,6 +354,8 @@ yui::ResourceLoader::ResourceLoader(Window *window)
         : m_window(window) {}
 
 yui::ResourceLoader::~ResourceLoader() {
+    save_glyph_caches();
+
     // TODO deallocate
     for (auto &font : m_fonts) {
         delete font;
@@ -231,6 +369,12 @@ void yui::ResourceLoader::set_default_font(FontResource *font) {
 }
 
 yui::FontResource *yui::ResourceLoader::load_font(std::string path, uint32_t pixel_size) {
+    for (auto *font : m_fonts) {
+        if (font->path() == path && font->font_size() == pixel_size) {
+            return font;
+        }
+    }
+
     FT_Face face;
     auto error = FT_New_Face(Application::the().freetype(), path.c_str(), 0, &face);
 
@@ -251,9 +395,13 @@ yui::FontResource *yui::ResourceLoader::load_font(std::string path, uint32_t pix
         return nullptr;
     }
 
-    auto *font = new FontResource(face, std::move(path), pixel_size);
+    auto *font = new FontResource(face, std::move(path), pixel_size, m_glyph_atlas);
     m_fonts.emplace_back(font);
 
+    if (!m_glyph_cache_directory.empty()) {
+        font->load_glyph_cache(m_glyph_cache_directory);
+    }
+
     if (m_default_font == nullptr) {
         m_default_font = font;
     }
@@ -262,7 +410,41 @@ yui::FontResource *yui::ResourceLoader::load_font(std::string path, uint32_t pix
     return font;
 }
 
+bool yui::ResourceLoader::upload_pending_glyphs() {
+    auto uploaded = false;
+    for (auto *font : m_fonts) {
+        if (font->upload_pending()) {
+            // Runs shaped with the placeholder metrics are stale now.
+            m_window->painter().shaping_cache().evict(font);
+            uploaded = true;
+        }
+    }
+
+    if (uploaded) {
+        ++m_glyph_generation;
+    }
+    return uploaded;
+}
+
+void yui::ResourceLoader::save_glyph_caches() {
+    if (m_glyph_cache_directory.empty()) {
+        return;
+    }
+
+    for (auto *font : m_fonts) {
+        if (font->glyph_cache_dirty()) {
+            font->save_glyph_cache(m_glyph_cache_directory);
+        }
+    }
+}
+
 void yui::ResourceLoader::remove_font(FontResource *removing) {
+    m_window->painter().shaping_cache().evict(removing);
+
+    if (!m_glyph_cache_directory.empty() && removing->glyph_cache_dirty()) {
+        removing->save_glyph_cache(m_glyph_cache_directory);
+    }
+
     for (auto it = m_fonts.begin(); it != m_fonts.end(); ++it) {
 
         if (*it == removing) {
@@ -286,3 +468,16 @@ yui::Shader *yui::ResourceLoader::load_shader(const std::string &path) {
         return nullptr;
     }
 }
+
+yui::Shader *yui::ResourceLoader::load_shader(const std::string &vertex_path, const std::string &fragment_path) {
+    try {
+        auto *shader = new Shader(vertex_path, fragment_path);
+        m_shaders.emplace_back(shader);
+        spdlog::info("Loaded vertex shader '{}' & fragment shader '{}'", vertex_path, fragment_path);
+        return shader;
+    }
+    catch (std::exception &) {
+        spdlog::error("Could not load vertex shader '{}' & fragment shader '{}'", vertex_path, fragment_path);
+        return nullptr;
+    }
+}
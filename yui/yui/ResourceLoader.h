@@ -1,43 +1,112 @@
 #pragma once
+#include <array>
+#include <bitset>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "Application.h"
 #include <glm/glm.hpp>
-#include "Badge.h"
+#include "GlyphAtlas.h"
+#include "GlyphCache.h"
 
 namespace yui {
 class Utf8String;
 struct Color;
-class Painter;
 class Window;
 
 class FontResource {
 private:
     struct CharacterTex;
+    struct GlyphBlock;
 
 public:
-    FontResource(FT_Face, std::string, uint32_t pixel_size);
+    using Glyph = CharacterTex;
+
+    FontResource(FT_Face, std::string, uint32_t pixel_size, GlyphAtlas &);
     ~FontResource();
-    glm::ivec2 text_size(const std::string_view &, Badge<Painter>);
-    glm::ivec2 text_size(const Utf8String &, Badge<Painter>);
-    CharacterTex *character(unsigned code_point);
+    // Glyphs of the BMP are found with two array lookups, no hashing or tree walk.
+    CharacterTex *character(unsigned code_point) {
+        if (code_point < BMP_SIZE) {
+            auto *block = m_blocks[code_point >> BLOCK_SHIFT].get();
+
+            if (block != nullptr && block->present[code_point & BLOCK_MASK]) {
+                return &block->glyphs[code_point & BLOCK_MASK];
+            }
+        } else if (const auto it = m_overflow.find(code_point); it != m_overflow.end()) {
+            return &it->second;
+        }
+
+        return load_character(code_point);
+    }
+    // Height of '|', which text is aligned to.
+    int line_height() {
+        auto *bar = line_height_glyph();
+        return bar != nullptr ? bar->size.y : 0;
+    }
+    CharacterTex *line_height_glyph() {
+        if (m_bar == nullptr) {
+            m_bar = character('|');
+        }
+        return m_bar;
+    }
+
+    // Moves glyphs finished by the rasterizer workers into the atlas, must run on the GL thread.
+    // Returns true when any glyph changed, text measured or painted with placeholders has to be
+    // laid out and repainted.
+    bool upload_pending();
+
+    // Glyph cache files in `directory`, see GlyphCacheFile.
+    bool load_glyph_cache(const std::string &directory);
+    bool save_glyph_cache(const std::string &directory);
+    // Glyphs were rasterized since the cache was loaded or saved.
+    [[nodiscard]] bool glyph_cache_dirty() const { return m_glyph_cache_dirty; }
 
     void set_font_size(uint32_t);
     uint32_t font_size() const { return m_pixel_size; }
 
     const std::string &path() const { return m_font_path; }
+private:
+    struct CharacterTex {
+        uint32_t texture_id{ 0 }; // The atlas page this glyph lives in.
+        glm::ivec2 size{ 0, 0 };
+        glm::ivec2 bearing{ 0, 0 };
+        long advance{ 0 };
+        glm::fvec4 uv{ }; // u0, v0, u1, v1 inside the atlas page.
+        glm::ivec2 atlas_position{ 0, 0 };
+        // Still being rasterized, size/bearing/advance come from the outline metrics until then.
+        bool pending{ false };
+    };
+
+    static constexpr unsigned BMP_SIZE = 0x10000;
+    static constexpr unsigned BLOCK_SHIFT = 8;
+    static constexpr unsigned BLOCK_SIZE = 1u << BLOCK_SHIFT;
+    static constexpr unsigned BLOCK_MASK = BLOCK_SIZE - 1;
+
+    // 256 code points worth of glyphs, stored inline. Only allocated once one of them is used,
+    // so Latin-1 text costs a single block.
+    struct GlyphBlock {
+        std::array<CharacterTex, BLOCK_SIZE> glyphs{ };
+        std::bitset<BLOCK_SIZE> present{ };
+    };
+
+    CharacterTex *load_character(unsigned code_point);
+    [[nodiscard]] CharacterTex *find(unsigned code_point);
+    // Pointers stay valid, blocks never move and unordered_map nodes are stable.
+    CharacterTex &emplace(unsigned code_point, const CharacterTex &);
+    template<typename Callable>
+    void for_each_glyph(Callable &&);
 private:
     FT_Face m_face{ };
     std::string m_font_path{ };
     uint32_t m_pixel_size{ };
-    std::map<unsigned, CharacterTex *> m_textures{ };
-
-    struct CharacterTex {
-        uint32_t texture_id;
-        glm::ivec2 size;
-        glm::ivec2 bearing;
-        long advance;
-    };
+    GlyphAtlas &m_atlas;
+    std::array<std::unique_ptr<GlyphBlock>, BMP_SIZE / BLOCK_SIZE> m_blocks{ };
+    std::unordered_map<unsigned, CharacterTex> m_overflow{ }; // Outside of the BMP, e.g. emoji.
+    CharacterTex *m_bar{ nullptr };
+    std::shared_ptr<GlyphSink> m_sink{ std::make_shared<GlyphSink>() };
+    uint64_t m_font_hash{ 0 }; // Computed on first use of the glyph cache.
+    bool m_glyph_cache_dirty{ false };
 
     unsigned m_vao{ 0 }, m_vbo{ 0 };
 };
@@ -123,17 +192,36 @@ public:
     // Font
     void set_default_font(FontResource *font);
     [[nodiscard]] FontResource *default_font() const { return m_default_font; }
+    // Returns the already loaded font when the same (path, size) was loaded before.
     FontResource *load_font(std::string, uint32_t pixel_size = 12);
 
     void remove_font(FontResource *);
 
+    // See FontResource::upload_pending(), bumps glyph_generation() when anything arrived.
+    bool upload_pending_glyphs();
+    [[nodiscard]] uint64_t glyph_generation() const { return m_glyph_generation; }
+
+    // When set, fonts warm up from a glyph cache file in this directory and write it back
+    // (if they rasterized anything new) when they're removed or the loader goes away.
+    void set_glyph_cache_directory(std::string directory) { m_glyph_cache_directory = std::move(directory); }
+    [[nodiscard]] const std::string &glyph_cache_directory() const { return m_glyph_cache_directory; }
+    void save_glyph_caches();
+
+    // Every font loaded through this loader packs its glyphs into this atlas.
+    [[nodiscard]] GlyphAtlas &glyph_atlas() { return m_glyph_atlas; }
+
     // will load vertex shader as path + ".vert" and fragment shader as path + ".frag"
     Shader *load_shader(const std::string &path);
+    // For programs that share a stage with another one, e.g. basic-compact.vert with basic.frag.
+    Shader *load_shader(const std::string &vertex_path, const std::string &fragment_path);
 private:
     Window *m_window;
     FontResource *m_default_font{ nullptr };
     std::vector<FontResource *> m_fonts{ };
     std::vector<Shader *> m_shaders{ };
+    GlyphAtlas m_glyph_atlas{ };
+    uint64_t m_glyph_generation{ 0 };
+    std::string m_glyph_cache_directory{ };
 };
 
 }
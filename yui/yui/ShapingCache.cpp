@@ -0,0 +1,74 @@
+#include "ShapingCache.h"
+#include <algorithm>
+
+void yui::ShapingCache::evict(const FontResource *font) {
+    for (auto it = m_runs.begin(); it != m_runs.end();) {
+        if (it->font == font) {
+            m_index.erase({ it->font, it->hash });
+            it = m_runs.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+void yui::ShapingCache::clear() {
+    m_runs.clear();
+    m_index.clear();
+}
+
+void yui::ShapingCache::set_capacity(size_t capacity) {
+    m_capacity = std::max<size_t>(capacity, 1);
+    trim();
+}
+
+const yui::ShapingCache::Run &yui::ShapingCache::shape_scratch(FontResource &font) {
+    // FNV-1a
+    auto hash = 0xcbf29ce484222325ull;
+    for (const auto code_point : m_scratch) {
+        hash ^= code_point;
+        hash *= 0x100000001b3ull;
+    }
+
+    const Key key{ &font, hash };
+    if (const auto it = m_index.find(key); it != m_index.end()) {
+        auto run = it->second;
+
+        if (run->code_points == m_scratch) {
+            m_runs.splice(m_runs.begin(), m_runs, run);
+            ++m_hits;
+            return *run;
+        }
+
+        // A different string with the same hash, replace it.
+        m_runs.erase(run);
+        m_index.erase(it);
+    }
+
+    ++m_misses;
+    Run run{ .font = &font, .hash = hash, .code_points = m_scratch };
+    run.glyphs.reserve(m_scratch.size());
+
+    for (const auto code_point : m_scratch) {
+        auto *glyph = font.character(code_point);
+
+        if (glyph == nullptr) {
+            continue;
+        }
+
+        run.glyphs.emplace_back(Glyph{ .glyph = glyph, .x = run.width });
+        run.width += static_cast<int>(glyph->advance >> 6);
+    }
+
+    m_runs.emplace_front(std::move(run));
+    m_index[key] = m_runs.begin();
+    trim();
+    return m_runs.front();
+}
+
+void yui::ShapingCache::trim() {
+    while (m_runs.size() > m_capacity) {
+        m_index.erase({ m_runs.back().font, m_runs.back().hash });
+        m_runs.pop_back();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ResourceLoader.h"
+#include "Utf8String.h"
+
+namespace yui {
+
+// Remembers the glyph run (glyphs + pen positions) and width of recently measured or drawn
+// strings, so layout and paint of unchanged text don't look up every glyph again.
+// Least recently used runs are dropped once the cache is full.
+class ShapingCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+    struct Glyph {
+        FontResource::Glyph *glyph{ nullptr };
+        int x{ 0 }; // Pen position relative to the start of the run.
+    };
+
+    struct Run {
+        const FontResource *font{ nullptr };
+        uint64_t hash{ 0 };
+        std::vector<unsigned> code_points{ }; // To tell hash collisions apart.
+        std::vector<Glyph> glyphs{ };
+        int width{ 0 };
+    };
+
+public:
+    // The returned run is valid until the next call to shape().
+    template<typename String>
+    const Run &shape(const String &string, FontResource &font) {
+        m_scratch.clear();
+        for (const auto &c : string) {
+            m_scratch.emplace_back(code_point_of(c));
+        }
+        return shape_scratch(font);
+    }
+
+    // Runs point into the font's glyph table, so they have to go before the font does.
+    void evict(const FontResource *);
+    void clear();
+
+    [[nodiscard]] size_t size() const { return m_runs.size(); }
+    [[nodiscard]] size_t capacity() const { return m_capacity; }
+    void set_capacity(size_t);
+
+    [[nodiscard]] size_t hits() const { return m_hits; }
+    [[nodiscard]] size_t misses() const { return m_misses; }
+private:
+    struct Key {
+        const FontResource *font;
+        uint64_t hash;
+
+        bool operator==(const Key &other) const { return font == other.font && hash == other.hash; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<const void *>()(key.font) ^ static_cast<size_t>(key.hash);
+        }
+    };
+
+    // Every byte of a std::string_view is taken as one code point.
+    static unsigned code_point_of(char c) { return c; }
+    static unsigned code_point_of(const Utf8String::Utf8CharacterInfo &info) { return info.code_point; }
+
+    const Run &shape_scratch(FontResource &);
+    void trim();
+private:
+    std::list<Run> m_runs{ }; // Most recently used first.
+    std::unordered_map<Key, std::list<Run>::iterator, KeyHash> m_index{ };
+    std::vector<unsigned> m_scratch{ };
+    size_t m_capacity{ DEFAULT_CAPACITY };
+    size_t m_hits{ 0 };
+    size_t m_misses{ 0 };
+};
+
+}
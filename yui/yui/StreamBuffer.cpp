@@ -0,0 +1,87 @@
+#include "StreamBuffer.h"
+#include "includes.h"
+
+yui::StreamBuffer::StreamBuffer(uint32_t target)
+        : m_target(target) {
+}
+
+bool yui::StreamBuffer::supported() {
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+void yui::StreamBuffer::create(size_t segment_size) {
+    destroy();
+
+    constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const auto total_size = static_cast<GLsizeiptr>(segment_size * SEGMENT_COUNT);
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(m_target, m_buffer);
+    glBufferStorage(m_target, total_size, nullptr, flags);
+    m_mapped = static_cast<uint8_t *>(glMapBufferRange(m_target, 0, total_size, flags));
+    glBindBuffer(m_target, 0);
+
+    m_segment_size = segment_size;
+    m_segment = 0;
+    spdlog::debug("Created stream buffer {} ({} x {} bytes)", m_buffer, SEGMENT_COUNT, segment_size);
+}
+
+void yui::StreamBuffer::destroy() {
+    if (m_buffer == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < SEGMENT_COUNT; ++i) {
+        wait(i);
+    }
+
+    glBindBuffer(m_target, m_buffer);
+    glUnmapBuffer(m_target);
+    glBindBuffer(m_target, 0);
+    glDeleteBuffers(1, &m_buffer);
+
+    m_buffer = 0;
+    m_mapped = nullptr;
+    m_segment_size = 0;
+}
+
+void *yui::StreamBuffer::map(size_t size) {
+    if (size > m_segment_size) {
+        // Round up generously so a slowly growing frame doesn't re-create the buffer every time.
+        auto new_size = std::max<size_t>(m_segment_size, 64 * 1024);
+        while (new_size < size) {
+            new_size *= 2;
+        }
+        create(new_size);
+    }
+
+    wait(m_segment);
+    return m_mapped + offset();
+}
+
+void yui::StreamBuffer::fence() {
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_segment = (m_segment + 1) % SEGMENT_COUNT;
+}
+
+void yui::StreamBuffer::wait(size_t segment) {
+    auto sync = static_cast<GLsync>(m_fences[segment]);
+
+    if (sync == nullptr) {
+        return;
+    }
+
+    // Flush on the first wait so the fence is guaranteed to signal eventually.
+    GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    constexpr GLuint64 timeout = 1'000'000; // 1ms
+    while (true) {
+        const auto result = glClientWaitSync(sync, wait_flags, timeout);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) {
+            break;
+        }
+        wait_flags = 0;
+    }
+
+    glDeleteSync(sync);
+    m_fences[segment] = nullptr;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace yui {
+
+// A buffer object that is persistently mapped and split into SEGMENT_COUNT segments which are
+// used round robin, one per frame. Each segment is guarded by a fence so the CPU never writes
+// into memory that the GPU may still be reading from (requires GL 4.4 / ARB_buffer_storage).
+class StreamBuffer {
+public:
+    static constexpr size_t SEGMENT_COUNT = 3;
+
+public:
+    explicit StreamBuffer(uint32_t target);
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer(StreamBuffer &&) = delete;
+    ~StreamBuffer() = default;
+
+    // Whether the current context supports persistently mapped buffers.
+    [[nodiscard]] static bool supported();
+
+    void create(size_t segment_size);
+    void destroy();
+
+    // Waits for the current segment to be released by the GPU and returns a pointer that can hold
+    // `size` bytes. Grows (and re-creates) the buffer when a segment is too small.
+    void *map(size_t size);
+
+    // Fences the current segment and moves on to the next one, call after the draws using it.
+    void fence();
+
+    [[nodiscard]] uint32_t buffer_id() const { return m_buffer; }
+    [[nodiscard]] uint32_t target() const { return m_target; }
+    // Offset in bytes of the current segment, relative to the start of the buffer.
+    [[nodiscard]] size_t offset() const { return m_segment * m_segment_size; }
+    [[nodiscard]] bool created() const { return m_buffer != 0; }
+private:
+    void wait(size_t segment);
+private:
+    uint32_t m_target;
+    uint32_t m_buffer{ 0 };
+    uint8_t *m_mapped{ nullptr };
+    size_t m_segment_size{ 0 };
+    size_t m_segment{ 0 };
+    std::array<void *, SEGMENT_COUNT> m_fences{ }; // GLsync
+};
+
+}
@@ -0,0 +1,134 @@
+#include "TaskPool.h"
+#include <algorithm>
+#include "spdlog/spdlog.h"
+
+// The pool and queue of the worker running on this thread.
+static thread_local const yui::TaskPool *t_pool = nullptr;
+static thread_local size_t t_queue = 0;
+
+yui::TaskPool::~TaskPool() {
+    stop();
+}
+
+void yui::TaskPool::start(unsigned worker_count) {
+    if (running()) {
+        return;
+    }
+
+    if (worker_count == 0) {
+        // The thread that waits works as well.
+        worker_count = std::clamp(std::thread::hardware_concurrency(), 2u, 9u) - 1;
+    }
+
+    m_stopping = false;
+    for (auto i = 0u; i <= worker_count; ++i) {
+        m_queues.emplace_back(std::make_unique<Queue>());
+    }
+
+    for (auto i = 0u; i < worker_count; ++i) {
+        m_workers.emplace_back(&TaskPool::work, this, i);
+    }
+    spdlog::info("Started {} task pool worker(s)", worker_count);
+}
+
+void yui::TaskPool::stop() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_queues.clear();
+    m_queued = 0;
+}
+
+void yui::TaskPool::run(Group &group, Task task) {
+    if (!running()) {
+        task();
+        return;
+    }
+
+    group.m_pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        auto &queue = *m_queues[home_queue()];
+        std::lock_guard lock(queue.mutex);
+        queue.entries.emplace_back(Entry{ .group = &group, .task = std::move(task) });
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock makes sure a worker either sees the task or is already waiting for the notification.
+    { std::lock_guard lock(m_mutex); }
+    m_condition.notify_one();
+}
+
+void yui::TaskPool::wait(Group &group) {
+    const auto home = running() ? home_queue() : 0;
+
+    while (group.m_pending.load(std::memory_order_acquire) != 0) {
+        if (!run_one(home)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+size_t yui::TaskPool::home_queue() const {
+    return t_pool == this ? t_queue : m_queues.size() - 1;
+}
+
+bool yui::TaskPool::run_one(size_t home) {
+    Entry entry{ };
+    auto found = false;
+
+    // Own tasks newest first, they are the most likely to still be in cache.
+    {
+        auto &queue = *m_queues[home];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.entries.empty()) {
+            entry = std::move(queue.entries.back());
+            queue.entries.pop_back();
+            found = true;
+        }
+    }
+
+    // Steal the oldest task of another queue, usually the biggest piece of work left.
+    for (size_t i = 1; !found && i < m_queues.size(); ++i) {
+        auto &queue = *m_queues[(home + i) % m_queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.entries.empty()) {
+            entry = std::move(queue.entries.front());
+            queue.entries.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    entry.task();
+    entry.group->m_pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void yui::TaskPool::work(size_t index) {
+    t_pool = this;
+    t_queue = index;
+
+    while (true) {
+        if (run_one(index)) {
+            continue;
+        }
+
+        std::unique_lock lock(m_mutex);
+        m_condition.wait(lock, [this]() { return m_stopping || m_queued.load(std::memory_order_acquire) != 0; });
+
+        if (m_stopping) {
+            return;
+        }
+    }
+}
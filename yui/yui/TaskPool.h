@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yui {
+
+// Runs short, independent tasks on a pool of worker threads. Every worker has its own queue, it
+// takes the newest task from it and steals the oldest from another queue once it runs dry.
+// A thread that waits for its tasks runs queued tasks meanwhile, so tasks may fork and wait themselves.
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+
+    // The tasks wait() waits for.
+    class Group {
+    public:
+        Group() = default;
+        Group(const Group &) = delete;
+        Group &operator=(const Group &) = delete;
+    private:
+        friend class TaskPool;
+        std::atomic<size_t> m_pending{ 0 };
+    };
+
+public:
+    TaskPool() = default;
+    TaskPool(const TaskPool &) = delete;
+    TaskPool(TaskPool &&) = delete;
+    ~TaskPool();
+
+    // 0 picks a count based on the hardware concurrency.
+    void start(unsigned worker_count = 0);
+    // Every group has to be waited for first.
+    void stop();
+    [[nodiscard]] bool running() const { return !m_workers.empty(); }
+    [[nodiscard]] size_t worker_count() const { return m_workers.size(); }
+
+    // Runs the task on the calling thread when the pool isn't running.
+    void run(Group &, Task);
+    void wait(Group &);
+private:
+    struct Entry {
+        Group *group{ nullptr };
+        Task task{ };
+    };
+
+    struct Queue {
+        std::mutex mutex{ };
+        std::deque<Entry> entries{ };
+    };
+
+    // The queue of a worker, or the one shared by every other thread.
+    [[nodiscard]] size_t home_queue() const;
+    bool run_one(size_t home);
+    void work(size_t index);
+private:
+    std::vector<std::thread> m_workers{ };
+    std::vector<std::unique_ptr<Queue>> m_queues{ };
+    std::atomic<size_t> m_queued{ 0 };
+    std::mutex m_mutex{ };
+    std::condition_variable m_condition{ };
+    bool m_stopping{ false };
+};
+
+}
@@ -130,6 +130,7 @@ void yui::Window::update(float dt)
 {
 	if (on_update) on_update(this, dt);
 
+	// Scroll deltas are per frame.
 	m_scroll_x = m_scroll_y = 0.0;
 }
 
@@ -139,6 +140,9 @@ void yui::Window::paint()
 	//glScissor(342, 20, 180, 18);
 	m_painter.clear(m_clear_color);
 	//glDisable(GL_SCISSOR_TEST);
+
+	// Glyphs rasterized off-thread since the last frame.
+	m_resource_loader.upload_pending_glyphs();
 	
 	if (on_paint) on_paint(this, &m_painter);
 
@@ -149,11 +153,13 @@ void yui::Window::paint()
 
 void yui::Window::gained_focus()
 {
+	request_redraw();
 	if (on_gained_focus) on_gained_focus(this);
 }
 
 void yui::Window::lost_focus()
 {
+	request_redraw();
 	if (on_lost_focus) on_lost_focus(this);
 }
 
@@ -164,22 +170,26 @@ void yui::Window::user_close()
 
 void yui::Window::key_down(int key, int scancode, int mods)
 {
+	request_redraw();
 	if (on_key_down) on_key_down(this, key, scancode, mods);
 }
 
 void yui::Window::key_up(int key, int scancode, int mods)
 {
+	request_redraw();
 	if (on_key_up) on_key_up(this, key, scancode, mods);
 }
 
 void yui::Window::input(unsigned codepoint)
 {
+	request_redraw();
 	if (on_input) on_input(this, codepoint);
 }
 
 
 void yui::Window::mouse_move(double x, double y)
 {
+	request_redraw();
 	m_mouse_x = static_cast<int>(x);
 	m_mouse_y = static_cast<int>(y);
 
@@ -190,14 +200,16 @@ void yui::Window::mouse_move(double x, double y)
 
 void yui::Window::mouse_scroll(double delta_x, double delta_y)
 {
+	request_redraw();
 	if (on_mouse_scroll) on_mouse_scroll(this, delta_x, delta_y);
 
-	m_scroll_x = delta_x;
-	m_scroll_y = delta_y;
+	m_scroll_x += delta_x;
+	m_scroll_y += delta_y;
 }
 
 void yui::Window::mouse_down(int button, int mods)
 {
+	request_redraw();
 	if (on_mouse_down) {
 		on_mouse_down(this, button, mods);
 	}
@@ -216,6 +228,7 @@ void yui::Window::mouse_down(int button, int mods)
 
 void yui::Window::mouse_up(int button, int mods)
 {
+	request_redraw();
 	if (on_mouse_up) {
 		on_mouse_up(this, button, mods);
 	}
@@ -234,6 +247,7 @@ void yui::Window::mouse_up(int button, int mods)
 
 void yui::Window::resize(int w, int h)
 {
+	request_redraw();
 	m_width = w;
 	m_height = h;
 	Application::the().window_resize(this, w, h);
@@ -249,16 +263,119 @@ void yui::Window::setup_environment()
 		throw std::exception();
 	}
 	
-	glfwSwapInterval(0);
+	glfwSwapInterval(m_vsync ? 1 : 0);
 
 	painter().present();
 }
 
+void yui::Window::set_raw_input(bool raw)
+{
+	m_raw_input = raw;
+
+	// Nothing queued may be left behind for events that now arrive directly.
+	if (m_raw_input) {
+		dispatch_events();
+	}
+}
+
+void yui::Window::queue_event(const InputEvent& event)
+{
+	if (m_raw_input) {
+		dispatch_event(event);
+		return;
+	}
+
+	request_redraw();
+
+	if (!m_pending_events.empty()) {
+		auto& last = m_pending_events.back();
+
+		if (event.type == InputEvent::Type::MouseMove && last.type == InputEvent::Type::MouseMove) {
+			last.x = event.x;
+			last.y = event.y;
+			return;
+		}
+
+		if (event.type == InputEvent::Type::MouseScroll && last.type == InputEvent::Type::MouseScroll) {
+			last.x += event.x;
+			last.y += event.y;
+			return;
+		}
+	}
+
+	m_pending_events.emplace_back(event);
+}
+
+void yui::Window::dispatch_events()
+{
+	// Handlers may queue more input, that waits for the next frame.
+	std::swap(m_pending_events, m_dispatching_events);
+
+	for (const auto& event : m_dispatching_events) {
+		dispatch_event(event);
+	}
+
+	m_dispatching_events.clear();
+}
+
+void yui::Window::dispatch_event(const InputEvent& event)
+{
+	switch (event.type) {
+	case InputEvent::Type::KeyDown:
+		key_down(event.key, event.scancode, event.mods);
+		break;
+	case InputEvent::Type::KeyUp:
+		key_up(event.key, event.scancode, event.mods);
+		break;
+	case InputEvent::Type::Input:
+		input(event.codepoint);
+		break;
+	case InputEvent::Type::MouseMove:
+		mouse_move(event.x, event.y);
+		break;
+	case InputEvent::Type::MouseScroll:
+		mouse_scroll(event.x, event.y);
+		break;
+	case InputEvent::Type::MouseDown:
+		mouse_down(event.key, event.mods);
+		break;
+	case InputEvent::Type::MouseUp:
+		mouse_up(event.key, event.mods);
+		break;
+	}
+}
+
 void yui::Window::update_fps(int fps)
 {
 	m_fps = fps;
 }
 
+void yui::Window::request_redraw()
+{
+	m_needs_redraw = true;
+}
+
+void yui::Window::request_redraw_after(double seconds)
+{
+	const auto deadline = glfwGetTime() + seconds;
+
+	if (m_redraw_deadline <= 0.0 || deadline < m_redraw_deadline) {
+		m_redraw_deadline = deadline;
+	}
+}
+
+bool yui::Window::redraw_due(double now) const
+{
+	return m_needs_redraw || (m_redraw_deadline > 0.0 && now >= m_redraw_deadline);
+}
+
+void yui::Window::did_redraw()
+{
+	// Input queued while dispatching still needs a frame of its own.
+	m_needs_redraw = !m_pending_events.empty();
+	m_redraw_deadline = 0.0;
+}
+
 // CALLBACKS
 
 #define GET_WINDOW() \
@@ -289,18 +406,16 @@ void callback_window_focus(GLFWwindow* wnd, int focused)
 void callback_window_key(GLFWwindow* wnd, int key, int scancode, int action, int mods)
 {
 	GET_WINDOW();
-	if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-		window->key_down(key, scancode, mods);
-	}
-	else {
-		window->key_up(key, scancode, mods);
-	}
+	const auto type = action == GLFW_PRESS || action == GLFW_REPEAT
+		? yui::InputEvent::Type::KeyDown
+		: yui::InputEvent::Type::KeyUp;
+	window->queue_event({ .type = type, .key = key, .scancode = scancode, .mods = mods });
 }
 
 void callback_window_character(GLFWwindow* wnd, unsigned code_point)
 {
 	GET_WINDOW();
-	window->input(code_point);
+	window->queue_event({ .type = yui::InputEvent::Type::Input, .codepoint = code_point });
 }
 
 void callback_window_size(GLFWwindow* wnd, int width, int height)
@@ -312,22 +427,20 @@ void callback_window_size(GLFWwindow* wnd, int width, int height)
 void callback_window_cursor_pos(GLFWwindow* wnd, double x, double y)
 {
 	GET_WINDOW();
-	window->mouse_move(x, y);
+	window->queue_event({ .type = yui::InputEvent::Type::MouseMove, .x = x, .y = y });
 }
 
 void callback_window_scroll(GLFWwindow* wnd, double delta_x, double delta_y)
 {
 	GET_WINDOW();
-	window->mouse_scroll(delta_x, delta_y);
+	window->queue_event({ .type = yui::InputEvent::Type::MouseScroll, .x = delta_x, .y = delta_y });
 }
 
 void callback_window_mouse_button(GLFWwindow* wnd, int button, int action, int mods)
 {
 	GET_WINDOW();
-	if (action == GLFW_PRESS) {
-		window->mouse_down(button, mods);
-	}
-	else {
-		window->mouse_up(button, mods);
-	}
+	const auto type = action == GLFW_PRESS
+		? yui::InputEvent::Type::MouseDown
+		: yui::InputEvent::Type::MouseUp;
+	window->queue_event({ .type = type, .key = button, .mods = mods });
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <functional>
 #include <string>
+#include <vector>
 #include "Painter.h"
 #include "ResourceLoader.h"
 #include "Clipboard.h"
@@ -10,6 +11,31 @@ struct GLFWwindow;
 namespace yui {
     class Application;
 
+	// Input as delivered by the glfw callbacks, queued until the window's next frame.
+	struct InputEvent
+	{
+		enum class Type
+		{
+			KeyDown,
+			KeyUp,
+			Input,
+			MouseMove,
+			MouseScroll,
+			MouseDown,
+			MouseUp,
+		};
+
+		Type type{};
+		// Cursor position for MouseMove, deltas for MouseScroll.
+		double x{};
+		double y{};
+		// Key or mouse button.
+		int key{};
+		int scancode{};
+		int mods{};
+		unsigned codepoint{};
+	};
+
 	class Window
 	{
 	public:
@@ -53,6 +79,15 @@ namespace yui {
 
 		int fps() const { return m_fps; }
 
+		// The application only refreshes windows that asked for it, idle windows cost nothing.
+		bool needs_redraw() const { return m_needs_redraw; }
+		void request_redraw();
+		// Schedules a refresh (e.g. a caret blink or an animation step) in `seconds` from now.
+		void request_redraw_after(double seconds);
+		// glfwGetTime() based point in time of the next scheduled refresh, 0 when none.
+		double redraw_deadline() const { return m_redraw_deadline; }
+		bool redraw_due(double now) const;
+
 		void use_arrow_cursor() const;
 		void use_input_cursor() const;
 		void use_hand_cursor() const;
@@ -60,6 +95,13 @@ namespace yui {
 		const Clipboard& clipboard() const { return m_clipboard; }
 		Clipboard& clipboard() { return m_clipboard; }
 
+		// Input is dispatched once per frame: cursor moves between two frames collapse into the last
+		// position and scroll deltas add up, everything else keeps its order.
+		// Raw input dispatches every event straight from the callback instead.
+		bool raw_input() const { return m_raw_input; }
+		void set_raw_input(bool);
+		void queue_event(const InputEvent&);
+
 		// events functions
 	public:
 		using KeyCode = int;
@@ -105,7 +147,10 @@ namespace yui {
 		virtual void update(float);
 		virtual void paint();
 		void setup_environment();
+		void dispatch_events();
+		void dispatch_event(const InputEvent&);
 		void update_fps(int fps);
+		void did_redraw();
 		friend class Application;
 	private:
 		uint32_t m_window_id{0};
@@ -124,6 +169,12 @@ namespace yui {
 		Color m_clear_color{255, 255, 255};
 		int m_fps{0};
 		bool m_did_init{false};
+		bool m_needs_redraw{true};
+		double m_redraw_deadline{0.0};
+		bool m_raw_input{false};
+		std::vector<InputEvent> m_pending_events{};
+		// Swapped with m_pending_events while dispatching, keeps both allocations around.
+		std::vector<InputEvent> m_dispatching_events{};
 		// Cursors
 		GLFWcursor *m_arrow_cursor{nullptr},
 			*m_input_cursor{nullptr},
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace yui::io {
+
+// Read-only memory mapping of a whole file, the pages are only read in when touched.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    ~MappedFile();
+
+    bool open(const std::string &path);
+    void close();
+
+    [[nodiscard]] bool is_open() const { return m_data != nullptr; }
+    [[nodiscard]] const uint8_t *data() const { return m_data; }
+    [[nodiscard]] size_t size() const { return m_size; }
+private:
+    const uint8_t *m_data{ nullptr };
+    size_t m_size{ 0 };
+#ifdef _WIN32
+    void *m_file{ nullptr };
+    void *m_mapping{ nullptr };
+#else
+    int m_fd{ -1 };
+#endif
+};
+
+}
@@ -9,7 +9,7 @@ void yui::layout::Box::paint(yui::Painter &painter) {
     PainterUtilities::paint_borders(painter, *this);
 
     for (auto *child : m_children) {
-        child->paint(painter);
+        child->paint_cached(painter);
     }
 }
 
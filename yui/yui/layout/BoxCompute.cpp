@@ -1,9 +1,45 @@
 #include "BoxCompute.h"
+#include <algorithm>
 #include "Box.h"
+#include "DocumentWidget.h"
+#include "../TaskPool.h"
 #include "../ymd/Node.h"
 #include "../yss/Computed.h"
 
+void yui::layout::BoxCompute::measure_boxes(LayoutNode &box) {
+    auto *pool = box.document_widget()->layout_pool();
+
+    if (pool == nullptr) {
+        return;
+    }
+
+    auto dirty_boxes = 0;
+    for (auto *child : box.children()) {
+        dirty_boxes += child->is_box() && child->subtree_needs_layout();
+    }
+
+    if (dirty_boxes < 2) {
+        return;
+    }
+
+    // A box's size doesn't depend on its siblings or on where it ends up, each subtree is laid out
+    // wherever it is now and only written to by its own task. Positioning them afterwards
+    // translates the subtrees, which gives the same result as laying them out in place.
+    TaskPool::Group group{ };
+    for (auto *child : box.children()) {
+        if (child->is_box() && child->subtree_needs_layout()) {
+            pool->run(group, [child]() { child->layout(); });
+        }
+    }
+    pool->wait(group);
+}
+
 void yui::layout::BoxCompute::compute_rows(LayoutNode &box) {
+    const auto inner_position = box.inner_position();
+
+    // Measure, then position the children in order. Measured subtrees are only moved into place.
+    measure_boxes(box);
+
     for (auto i = 0u, sz = box.children().size(); i < sz; ++i) {
         auto *prev = i == 0 ? nullptr : box.children().at(i - 1);
         auto *child = box.children().at(i);
@@ -13,7 +49,7 @@ void yui::layout::BoxCompute::compute_rows(LayoutNode &box) {
         const auto prev_rect = prev ? prev->absolute_rect() : Rect{ 0, 0, 0, 0 };
 
         if (child->is_inline() || child->is_input()) {
-            child->compute();
+            child->layout();
 
             if (prev && prev->is_inline()) {
                 // TODO: Consider virtual lines.
@@ -35,15 +71,15 @@ void yui::layout::BoxCompute::compute_rows(LayoutNode &box) {
                 // TODO: based on the current direction.
                 child->set_position(
                         {
-                                box.inner_position().x + margin.left,
+                                inner_position.x + margin.left,
                                 prev_rect.bottom + prev_margin.bottom + margin.top
                         }
                 );
             } else {
                 child->set_position(
                         {
-                                box.inner_position().x + margin.left,
-                                box.inner_position().y + margin.top
+                                inner_position.x + margin.left,
+                                inner_position.y + margin.top
                         }
                 );
             }
@@ -52,20 +88,20 @@ void yui::layout::BoxCompute::compute_rows(LayoutNode &box) {
             if (prev) {
                 child->set_position(
                         {
-                                box.inner_position().x + margin.left,
+                                inner_position.x + margin.left,
                                 prev_rect.bottom + prev_margin.bottom + margin.top
                         }
                 );
             } else {
                 child->set_position(
                         {
-                                box.inner_position().x + margin.left,
-                                box.inner_position().y + margin.top
+                                inner_position.x + margin.left,
+                                inner_position.y + margin.top
                         }
                 );
             }
 
-            child->compute();
+            child->layout();
         }
     }
 
@@ -91,11 +127,11 @@ void yui::layout::BoxCompute::compute_rows(LayoutNode &box) {
         }
 
         // Box remaining
-        size.y += child->size_with_padding().y;
-        size.y += child->dom_node()->computed().margin().top + child->dom_node()->computed().margin().bottom;
+        const auto margin = child->dom_node()->computed().margin();
+        const auto child_size = child->size_with_padding();
+        size.y += child_size.y + margin.top + margin.bottom;
 
-        auto x_accum = child->dom_node()->computed().margin().left + child->size_with_padding().x
-                + child->dom_node()->computed().margin().right;
+        auto x_accum = margin.left + child_size.x + margin.right;
         if (x_accum > size.x) {
             size.x = x_accum;
         }
@@ -112,17 +148,12 @@ void yui::layout::BoxCompute::compute_rows(LayoutNode &box) {
 
         for (auto j = i; j < sz; ++j) {
             auto *child = box.children().at(j);
-            if (child->size_with_padding().y > max_y) {
-                max_y = child->size_with_padding().y;
-            }
-
-            auto margin = child->dom_node()->computed().margin();
-
-            if (margin.bottom > max_bottom_margin) {
-                max_bottom_margin = child->dom_node()->computed().margin().bottom;
-            }
+            const auto margin = child->dom_node()->computed().margin();
+            const auto child_size = child->size_with_padding();
 
-            x_accumulated += margin.left + child->size_with_padding().x + margin.right;
+            max_y = std::max(max_y, child_size.y);
+            max_bottom_margin = std::max(max_bottom_margin, margin.bottom);
+            x_accumulated += margin.left + child_size.x + margin.right;
         }
 
         size.y += max_y + max_bottom_margin;
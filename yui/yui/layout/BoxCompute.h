@@ -7,6 +7,9 @@ class BoxCompute {
 public:
     static void compute_rows(LayoutNode &box);
     static void compute_columns(Box &box);
+private:
+    // Lays out the dirty block children concurrently when the document widget has a layout pool.
+    static void measure_boxes(LayoutNode &box);
 };
 
 }
\ No newline at end of file
@@ -5,59 +5,215 @@
 #include "Inline.h"
 #include "InlineBox.h"
 #include "Input.h"
+#include "LayoutArena.h"
 #include "LayoutTreeDumper.h"
 #include "Textarea.h"
+#include "../Application.h"
 #include "../Window.h"
 #include "../ymd/DocumentNode.h"
 #include "../yss/StyleHelper.h"
 
+yui::layout::DocumentWidget::DocumentWidget()
+        : m_layout_arena(std::make_unique<LayoutArena>()) {}
+
 yui::layout::DocumentWidget::DocumentWidget(DocumentNode *doc, Window *wnd)
-        : m_dom_document(doc), m_window(wnd) {
+        : m_dom_document(doc), m_window(wnd), m_layout_arena(std::make_unique<LayoutArena>()) {
     m_dom_node = reinterpret_cast<yui::Node *>(doc);
 }
 
+yui::layout::DocumentWidget::~DocumentWidget() = default;
+
 void yui::layout::DocumentWidget::set_dom_document(DocumentNode *node) {
     m_dom_document = node;
 }
 
 void yui::layout::DocumentWidget::paint(yui::Painter &painter) {
     BENCHMARK_BEGIN
+                        if (m_window && m_window->resource_loader().glyph_generation() != m_glyph_generation) {
+                            m_glyph_generation = m_window->resource_loader().glyph_generation();
+                            mark_paint_dirty();
+                            m_damage_all = true;
+
+                            // Their size came from placeholder metrics, measure them again (nodes that
+                            // still wait for glyphs add themselves back).
+                            auto pending = std::move(m_pending_glyph_nodes);
+                            m_pending_glyph_nodes.clear();
+                            std::sort(pending.begin(), pending.end());
+                            pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+                            for (auto *node : pending) {
+                                invalidate_node(*node);
+                            }
+                        }
+
+                        if (painter.retained()) {
+                            collect_damage(painter);
+
+                            // Nothing changed, the retained frame is still valid.
+                            if (!painter.has_damage()) {
+                                return;
+                            }
+                        }
+
                         for (auto &child : m_children) {
-                            child->paint(painter);
+                            child->paint_cached(painter);
                         }
+
+                        m_needs_repaint = m_child_needs_repaint = false;
     BENCHMARK_END
 }
 
+void yui::layout::DocumentWidget::collect_damage(yui::Painter &painter) {
+    if (m_damage_all) {
+        painter.damage_all();
+        m_damage_all = false;
+    }
+
+    if (!subtree_needs_repaint()) {
+        return;
+    }
+
+    const auto to_damage = [](const Rect &rect) {
+        return glm::ivec4{ rect.left, rect.top, rect.right - rect.left, rect.bottom - rect.top };
+    };
+
+    traverse_cancelable(
+            [&](LayoutNode *node) {
+                if (!node->subtree_needs_repaint()) {
+                    return false;
+                }
+
+                if (node->needs_repaint()) {
+                    if (node->has_been_painted()) {
+                        painter.add_damage(to_damage(node->painted_rect()));
+                    }
+                    painter.add_damage(to_damage(node->paint_bounds()));
+                }
+                return true;
+            }
+    );
+}
+
 void yui::layout::DocumentWidget::update(float dt) {
     //compute();
     LayoutNode::update(dt);
 
+    // Only what a ui state, class or id change invalidated is restyled.
+    if (m_dom_document->needs_style_recalc()) {
+        std::vector<RestyledNode> restyled{ };
+        m_dom_document->update_styles(restyled);
+        invalidate_restyled(restyled);
+
+        if (!restyled.empty()) {
+            update_cursor();
+        }
+    }
+
     if (m_dirty_layout) {
-        auto new_cursor = ComputedCursorMode::None;
         for (auto *dirty : m_dirty_nodes) {
-            dirty->dom_node()->compute_styles();
-            dirty->compute();
-
-            if (dirty->dom_node()->hovered() && dirty->dom_node()->computed().cursor() != ComputedCursorMode::None) {
-                new_cursor = dirty->dom_node()->computed().cursor();
+            if (dirty == this) {
+                dom_node()->compute_styles();
+                mark_subtree_needs_layout();
+                m_damage_all = true;
             }
         }
 
-        switch (new_cursor) {
-        case ComputedCursorMode::Input:
-            m_window->use_input_cursor();
-            break;
-        case ComputedCursorMode::Hand:
-            m_window->use_hand_cursor();
-            break;
-        case ComputedCursorMode::None:
-        default:
-            m_window->use_arrow_cursor();
-            break;
-        }
+        relayout();
+        update_cursor();
 
         m_dirty_nodes.clear();
         m_dirty_layout = false;
+        m_hit_grid.update();
+    }
+}
+
+void yui::layout::DocumentWidget::relayout() {
+    BENCHMARK_BEGIN
+                        for (auto *dirty : m_dirty_nodes) {
+                            auto *node = dirty;
+                            while (node != this) {
+                                const auto previous_size = node->size_with_padding();
+                                node->layout();
+
+                                // Same size, the parent wouldn't move any of the siblings.
+                                if (node->size_with_padding() == previous_size) {
+                                    break;
+                                }
+                                node = node->parent();
+                                node->mark_needs_layout();
+                            }
+
+                            if (node == this) {
+                                compute();
+                            }
+
+                            // layout() only marked the subtree, the display lists of the ancestors are stale too.
+                            node->mark_self_paint_dirty();
+                        }
+
+                // Everything is laid out, but the ancestors above where the size stopped changing
+                // still think one of their descendants needs layout.
+                for (auto *dirty : m_dirty_nodes) {
+                    for (auto *node = dirty->parent(); node != nullptr; node = node->parent()) {
+                        node->m_child_needs_layout = false;
+                    }
+                }
+    BENCHMARK_END
+}
+
+void yui::layout::DocumentWidget::update_cursor() {
+    if (m_window == nullptr) {
+        return;
+    }
+
+    const auto cursor = m_hovered != nullptr ? m_hovered->dom_node()->computed().cursor() : ComputedCursorMode::None;
+
+    switch (cursor) {
+    case ComputedCursorMode::Input:
+        m_window->use_input_cursor();
+        break;
+    case ComputedCursorMode::Hand:
+        m_window->use_hand_cursor();
+        break;
+    case ComputedCursorMode::None:
+    default:
+        m_window->use_arrow_cursor();
+        break;
+    }
+}
+
+void yui::layout::DocumentWidget::invalidate_restyled(const std::vector<RestyledNode> &restyled) {
+    if (restyled.empty()) {
+        return;
+    }
+
+    for (const auto &[node, effects, subtree] : restyled) {
+        const auto it = m_layout_nodes.find(node);
+
+        if (it == m_layout_nodes.end()) {
+            continue;
+        }
+
+        auto *layout_node = it->second;
+        if (!has_effect(effects, StylesheetPropertyEffect::Layout)) {
+            // A color or background, nothing moves. Descendants inheriting it were restyled themselves,
+            // a cursor change alone leaves nothing to redo.
+            if (has_effect(effects, StylesheetPropertyEffect::Paint)) {
+                layout_node->mark_self_paint_dirty();
+            }
+            continue;
+        }
+
+        if (subtree) {
+            layout_node->mark_subtree_needs_layout();
+        } else {
+            layout_node->mark_needs_layout();
+        }
+
+        // Margins are applied by the parent, start there.
+        auto *parent = layout_node->parent() != nullptr ? layout_node->parent() : layout_node;
+        parent->mark_needs_layout();
+        m_dirty_nodes.emplace_back(parent);
+        m_dirty_layout = true;
     }
 }
 
@@ -70,17 +226,19 @@ void yui::layout::DocumentWidget::compute() {
                         margin.left + margin.right,
                         margin.top + margin.bottom
                 };
+                m_needs_layout = false;
+                m_child_needs_layout = false;
     BENCHMARK_END
 }
 
 void yui::layout::DocumentWidget::clear_layout_tree() {
-    std::vector<LayoutNode *> nodes{ };
-    flatten(nodes);
-
-    for (auto *node : nodes) {
-        delete node;
-    }
+    m_hit_grid.clear();
+    m_hovered = nullptr;
     m_children.clear();
+    m_dirty_nodes.clear();
+    m_pending_glyph_nodes.clear();
+    m_layout_nodes.clear();
+    m_layout_arena->clear();
 }
 
 yui::layout::LayoutNode *yui::layout::DocumentWidget::fragment_allocate_or_take_parent(Node *dom_node) {
@@ -91,7 +249,7 @@ yui::layout::LayoutNode *yui::layout::DocumentWidget::fragment_allocate_or_take_
         return inl;
     }
 
-    auto *inl = new Inline();
+    auto *inl = m_layout_arena->create<Inline>();
     if (dom_node->is_fragment()) {
         inl->append_fragment(*dynamic_cast<TextFragmentNode *>(dom_node));
     }
@@ -110,25 +268,25 @@ yui::layout::LayoutNode *yui::layout::DocumentWidget::allocate_display_node(Comp
 }
 
 yui::layout::LayoutNode *yui::layout::DocumentWidget::allocate_box_context(Node *dom_node) {
-    auto *box = new Box();
+    auto *box = m_layout_arena->create<Box>();
     box->set_dom_node(dom_node);
     return box;
 }
 
 yui::layout::LayoutNode *yui::layout::DocumentWidget::allocate_input_node(Node *dom_node) {
-    auto *node = new Input();
+    auto *node = m_layout_arena->create<Input>();
     node->set_dom_node(dom_node);
     return node;
 }
 
 yui::layout::LayoutNode *yui::layout::DocumentWidget::allocate_textarea_node(Node *dom_node) {
-    auto *textarea = new Textarea();
+    auto *textarea = m_layout_arena->create<Textarea>();
     textarea->set_dom_node(dom_node);
     return textarea;
 }
 
 yui::layout::LayoutNode *yui::layout::DocumentWidget::rearrange_into_box(Node *dom_node) {
-    auto *box = new InlineBox();
+    auto *box = m_layout_arena->create<InlineBox>();
     box->set_document_widget(this);
 
     // Fetch the currently top of stack parent.
@@ -177,18 +335,18 @@ yui::layout::LayoutNode *yui::layout::DocumentWidget::allocate_layout_node(Node
     return allocate_display_node(dom_node->computed().display(), dom_node);
 }
 
-bool yui::layout::DocumentWidget::has_loaded_font(const std::string &font_name, int font_size) const {
+bool yui::layout::DocumentWidget::has_loaded_font(Atom font_name, int font_size) const {
     return std::find_if(
-            m_loaded_fonts.begin(), m_loaded_fonts.end(), [&](auto *font) {
-                return font->path() == font_name && font->font_size() == font_size;
+            m_loaded_fonts.begin(), m_loaded_fonts.end(), [&](const LoadedFont &loaded) {
+                return loaded.name == font_name && loaded.size == font_size;
             }
     ) != m_loaded_fonts.end();
 }
 
-yui::FontResource *yui::layout::DocumentWidget::loaded_font(const std::string &cs, int font_size) {
+yui::FontResource *yui::layout::DocumentWidget::loaded_font(Atom font_name, int font_size) {
     const auto it = std::find_if(
-            m_loaded_fonts.begin(), m_loaded_fonts.end(), [&](auto *font) {
-                return font->path() == cs && font->font_size() == static_cast<uint32_t>(font_size);
+            m_loaded_fonts.begin(), m_loaded_fonts.end(), [&](const LoadedFont &loaded) {
+                return loaded.name == font_name && loaded.size == font_size;
             }
     );
 
@@ -196,30 +354,60 @@ yui::FontResource *yui::layout::DocumentWidget::loaded_font(const std::string &c
         return nullptr;
     }
 
-    return *it;
+    return it->font;
+}
+
+void yui::layout::DocumentWidget::set_parallel_layout(bool parallel) {
+    if (!parallel) {
+        m_layout_pool = nullptr;
+        return;
+    }
+
+    m_layout_pool = &Application::the().task_pool();
+    m_layout_pool->start();
+}
+
+glm::ivec2 yui::layout::DocumentWidget::measure_text(const Utf8String &text, FontResource &font, LayoutNode &measured) {
+    return measure_text_locked(text, font, measured);
+}
+
+glm::ivec2 yui::layout::DocumentWidget::measure_text(std::string_view text, FontResource &font, LayoutNode &measured) {
+    return measure_text_locked(text, font, measured);
+}
+
+template<typename String>
+glm::ivec2 yui::layout::DocumentWidget::measure_text_locked(const String &text, FontResource &font, LayoutNode &measured) {
+    std::lock_guard lock(m_measure_mutex);
+    const auto &run = m_window->painter().shaping_cache().shape(text, font);
+
+    const auto pending = std::any_of(run.glyphs.begin(), run.glyphs.end(), [](const auto &glyph) {
+        return glyph.glyph->pending;
+    });
+    if (pending || (font.line_height_glyph() != nullptr && font.line_height_glyph()->pending)) {
+        m_pending_glyph_nodes.emplace_back(&measured);
+    }
+
+    return { run.width, font.line_height() };
 }
 
 yui::FontResource *yui::layout::DocumentWidget::default_font() {
     if (m_loaded_fonts.empty()) { return nullptr; }
-    return m_loaded_fonts[0];
+    return m_loaded_fonts[0].font;
 }
 
 void yui::layout::DocumentWidget::did_reload_stylesheets() {
     m_dom_document->compute_styles();
     load_fonts();
+    mark_subtree_needs_layout();
     compute();
+    m_hit_grid.update();
+    mark_paint_dirty();
+    m_damage_all = true;
 }
 
 const yui::layout::LayoutNode *yui::layout::DocumentWidget::find_layout_node(Node *dom_node) const {
-    const LayoutNode *result = nullptr;
-    traverse(
-            [&](const LayoutNode *node) {
-                if (node->dom_node() == dom_node) {
-                    result = node;
-                }
-            }
-    );
-    return result;
+    const auto it = m_layout_nodes.find(dom_node);
+    return it != m_layout_nodes.end() ? it->second : nullptr;
 }
 
 void yui::layout::DocumentWidget::construct_layout_tree() {
@@ -232,48 +420,106 @@ void yui::layout::DocumentWidget::construct_layout_tree() {
         construct_layout_tree(child);
     }
     m_construction_stack = { };
+    traverse([&](LayoutNode *layout_node) { m_layout_nodes[layout_node->dom_node()] = layout_node; });
 
     // Load fonts after construction of layout tree.
     load_fonts();
     compute();
+    m_hit_grid.rebuild(*this);
+    mark_paint_dirty();
+    m_damage_all = true;
 }
 
 void yui::layout::DocumentWidget::invalidate_node(LayoutNode &node) {
     m_dirty_layout = true;
+    node.mark_needs_layout();
     m_dirty_nodes.emplace_back(&node);
+
+    if (m_window) {
+        m_window->request_redraw();
+    }
 }
 
 void yui::layout::DocumentWidget::invalidate() {
     m_dirty_layout = true;
     m_dirty_nodes.emplace_back(this);
+
+    if (m_window) {
+        m_window->request_redraw();
+    }
 }
 
 void yui::layout::DocumentWidget::mouse_move(double x, double y) {
     BENCHMARK_BEGIN
-                        LayoutNode *deepest_hit = nullptr;
-                std::vector<LayoutNode *> changed_nodes{ };
+                        auto *target = m_hit_grid.hit({ static_cast<int>(x), static_cast<int>(y) });
+
+                // Nothing to restyle or relayout while the cursor stays over the same node.
+                if (target == m_hovered) {
+                    return;
+                }
 
-                for (auto *child : m_children) {
-                    if (child->on_mouse_move({ static_cast<int>(x), static_cast<int>(y) })) {
-                        break;
+                // The hover state restyles the nodes :hover rules apply to, update() then
+                // relayouts or repaints them depending on what changed.
+                if (m_hovered != nullptr) {
+                    // Node::set_hovered(false) only clears the state of *other* nodes.
+                    if (target == nullptr) {
+                        m_dom_document->set_current_ui_state_node(NodeUiState::Hovered, nullptr);
                     }
+                    m_hovered->on_mouse_leave();
+                }
+
+                m_hovered = target;
+                if (target != nullptr) {
+                    target->dom_node()->set_hovered(true);
+                    target->on_mouse_enter();
+                }
+
+                update_cursor();
+                if (m_window) {
+                    m_window->request_redraw();
                 }
     BENCHMARK_END
 }
 
 void yui::layout::DocumentWidget::mouse_left_down(int mouse_x, int mouse_y) {
-    for (auto *child : m_children) {
-        if (child->on_left_mouse_down({ mouse_x, mouse_y })) {
-            break;
-        }
+    auto *target = m_hit_grid.hit({ mouse_x, mouse_y });
+
+    if (target == nullptr) {
+        return;
     }
+
+    target->on_mouse_down({ mouse_x, mouse_y });
 }
 
 void yui::layout::DocumentWidget::mouse_left_up(int mouse_x, int mouse_y) {
-    for (auto *child : m_children) {
-        if (child->on_left_mouse_up({ mouse_x, mouse_y })) {
-            break;
-        }
+    auto *target = m_hit_grid.hit({ mouse_x, mouse_y });
+
+    if (target == nullptr) {
+        return;
+    }
+
+    auto *previous = m_dom_document->current_ui_state_node(NodeUiState::Focused);
+    target->dom_node()->set_focused(true);
+    if (previous != target->dom_node()) {
+        focus_changed(previous, *target);
+    }
+
+    target->on_click({ mouse_x, mouse_y });
+    if (m_window) {
+        m_window->request_redraw();
+    }
+}
+
+void yui::layout::DocumentWidget::focus_changed(Node *previous, LayoutNode &focused) {
+    // Inputs paint their caret and placeholder depending on focus, whether or not a :focus rule restyles them.
+    focused.mark_paint_dirty();
+
+    if (previous == nullptr) {
+        return;
+    }
+
+    if (const auto it = m_layout_nodes.find(previous); it != m_layout_nodes.end()) {
+        it->second->mark_paint_dirty();
     }
 }
 
@@ -331,19 +577,12 @@ void yui::layout::DocumentWidget::construct_layout_tree(Node *dom_node) {
     if (do_pop) { m_construction_stack.pop(); }
 }
 
-void yui::layout::DocumentWidget::flatten(std::vector<LayoutNode *> &nodes) {
-    traverse(
-            [&](LayoutNode *node) {
-                nodes.emplace_back(node);
-            }
-    );
-}
 
 void yui::layout::DocumentWidget::load_fonts() {
     BENCHMARK_BEGIN
                         traverse(
                                 [&](LayoutNode *node) {
-                                    auto text = node->dom_node()->computed().text();
+                                    const auto &text = node->dom_node()->computed().text();
 
                                     if (text.font_name.empty() || text.font_size == 0) {
                                         return;
@@ -353,20 +592,22 @@ void yui::layout::DocumentWidget::load_fonts() {
                                         return;
                                     }
 
-                                    auto *font = window()->resource_loader().load_font(text.font_name, text.font_size);
+                                    auto *font = window()->resource_loader().load_font(text.font_name.str(), text.font_size);
 
                                     if (font == nullptr) {
                                         Application::the().report_error(
                                                 fmt::format(
                                                         "Could not load font {} (with size={})",
-                                                        text.font_name,
+                                                        text.font_name.str(),
                                                         text.font_size
                                                 )
                                         );
                                         return;
                                     }
 
-                                    m_loaded_fonts.emplace_back(font);
+                                    m_loaded_fonts.emplace_back(
+                                            LoadedFont{ .name = text.font_name, .size = text.font_size, .font = font }
+                                    );
                                 }
                         );
     BENCHMARK_END
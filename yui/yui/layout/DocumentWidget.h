@@ -1,6 +1,10 @@
 #pragma once
+#include <mutex>
 #include <stack>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include "HitGrid.h"
 #include "LayoutNode.h"
 #include "../io/Profiler.h"
 #include "../yss/StylesheetDeclaration.h"
@@ -10,14 +14,20 @@ enum class ComputedDisplay;
 class Window;
 class FontResource;
 class DocumentNode;
+struct RestyledNode;
+class TaskPool;
+class Utf8String;
 }
 
 namespace yui::layout {
 
+class LayoutArena;
+
 class DocumentWidget : public LayoutNode {
 public:
-    DocumentWidget() = default;
+    DocumentWidget();
     DocumentWidget(DocumentNode *, Window *);
+    ~DocumentWidget() override;
 
     [[nodiscard]] Window *window() const { return m_window; }
 
@@ -27,14 +37,24 @@ public:
     void paint(yui::Painter &) override;
     void update(float dt) override;
     void compute() override;
-    [[nodiscard]] bool has_loaded_font(const std::string &font_name, int font_size) const;
-    FontResource *loaded_font(const std::string &cs, int font_size);
+    [[nodiscard]] bool has_loaded_font(Atom font_name, int font_size) const;
+    FontResource *loaded_font(Atom font_name, int font_size);
     FontResource *default_font();
     void did_reload_stylesheets();
 
+    // Sibling block subtrees are measured on the application's task pool, then positioned in order,
+    // see BoxCompute::compute_rows(). The result is the same as laying out serially.
+    void set_parallel_layout(bool);
+    // nullptr when layout is serial.
+    [[nodiscard]] TaskPool *layout_pool() const { return m_layout_pool; }
+    // Painter::text_size() for compute(), which may run on several threads at once. The node is laid
+    // out again once the glyphs that are still being rasterized arrive.
+    glm::ivec2 measure_text(const Utf8String &, FontResource &, LayoutNode &measured);
+    glm::ivec2 measure_text(std::string_view, FontResource &, LayoutNode &measured);
+
     [[nodiscard]] bool is_root() const override { return true; }
 
-    // Find a layout node from dom node
+    // Find a layout node from dom node, a lookup in the map built by construct_layout_tree().
     const LayoutNode *find_layout_node(Node *node) const;
 
     [[nodiscard]] const char *layout_name() const override { return "document"; }
@@ -53,6 +73,7 @@ public:
 public:
     void construct_layout_tree();
 
+    // Lays the node out again with the next update, its ancestors follow as long as their size changes.
     void invalidate_node(LayoutNode &);
     void invalidate();
 
@@ -72,7 +93,6 @@ private:
     LayoutNode *allocate_layout_node(Node *dom_node);
     void clear_layout_tree();
     void construct_layout_tree(Node *);
-    void flatten(std::vector<LayoutNode *> &nodes);
 
     template<typename Callable>
     void traverse_children(LayoutNode *node, Callable &&callable);
@@ -86,13 +106,47 @@ private:
     void traverse_children_cancelable(const LayoutNode *node, Callable &&callable) const;
 
     void load_fonts();
+    // Queues relayout for restyled nodes whose layout is affected, the others are only repainted.
+    void invalidate_restyled(const std::vector<RestyledNode> &restyled);
+    // Lays out the invalidated nodes and, bottom up, every ancestor whose size changed because of them.
+    void relayout();
+    void update_cursor();
+    template<typename String>
+    glm::ivec2 measure_text_locked(const String &, FontResource &, LayoutNode &measured);
+    // Repaints the nodes that lost and gained focus.
+    void focus_changed(Node *previous, LayoutNode &focused);
+    // Adds the old and new rects of every node that needs repainting to the painter's damage.
+    void collect_damage(yui::Painter &);
 private:
     DocumentNode *m_dom_document{ nullptr };
     Window *m_window{ nullptr };
     std::stack<LayoutNode *> m_construction_stack{ };
-    std::vector<FontResource *> m_loaded_fonts{ };
+    // Every node of the tree lives here, rebuilding the tree reuses its memory.
+    std::unique_ptr<LayoutArena> m_layout_arena{ };
+    HitGrid m_hit_grid{ };
+    // The node mouse_move() last found under the cursor.
+    LayoutNode *m_hovered{ nullptr };
+    struct LoadedFont {
+        Atom name{ };
+        int size{ 0 };
+        FontResource *font{ nullptr };
+    };
+    // Looked up by the atom the computed style holds, not the path of the font.
+    std::vector<LoadedFont> m_loaded_fonts{ };
     bool m_dirty_layout{ false };
     std::vector<LayoutNode *> m_dirty_nodes{ };
+    // Restyled and focused nodes are found without walking the layout tree, the last layout node
+    // of a dom node wins (the one a pre-order traversal visits last).
+    std::unordered_map<const Node *, LayoutNode *> m_layout_nodes{ };
+    // Set when the whole tree is re-laid out, previous positions are unknown then.
+    bool m_damage_all{ true };
+    // Cached display lists may hold placeholders for glyphs that have been rasterized since.
+    uint64_t m_glyph_generation{ 0 };
+    // Measured with placeholder metrics, guarded by m_measure_mutex.
+    std::vector<LayoutNode *> m_pending_glyph_nodes{ };
+    TaskPool *m_layout_pool{ nullptr };
+    // The painter's shaping cache isn't thread safe.
+    std::mutex m_measure_mutex{ };
 };
 
 template<typename Callable>
@@ -0,0 +1,98 @@
+#include "HitGrid.h"
+#include <algorithm>
+
+void yui::layout::HitGrid::rebuild(LayoutNode &root) {
+    clear();
+
+    for (auto *child : root.children()) {
+        add(*child);
+    }
+}
+
+void yui::layout::HitGrid::update() {
+    for (uint32_t i = 0; i < m_entries.size(); ++i) {
+        auto &entry = m_entries[i];
+        const auto rect = entry.node->absolute_rect();
+
+        if (rect.top == entry.rect.top && rect.left == entry.rect.left
+                && rect.bottom == entry.rect.bottom && rect.right == entry.rect.right) {
+            continue;
+        }
+
+        remove(i);
+        entry.rect = rect;
+        insert(i);
+    }
+}
+
+void yui::layout::HitGrid::clear() {
+    m_entries.clear();
+    m_cells.clear();
+}
+
+yui::layout::LayoutNode *yui::layout::HitGrid::hit(glm::ivec2 point) const {
+    const auto it = m_cells.find(cell_key(cell_of(point.x), cell_of(point.y)));
+
+    if (it == m_cells.end()) {
+        return nullptr;
+    }
+
+    for (const auto index : it->second) {
+        if (m_entries[index].node->hit_test(point.x, point.y)) {
+            return m_entries[index].node;
+        }
+    }
+
+    return nullptr;
+}
+
+int yui::layout::HitGrid::cell_of(int coordinate) {
+    // Rounds towards negative infinity, nodes can be scrolled or pushed above/left of the origin.
+    return coordinate >= 0 ? coordinate / CELL_SIZE : (coordinate - CELL_SIZE + 1) / CELL_SIZE;
+}
+
+uint64_t yui::layout::HitGrid::cell_key(int x, int y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+template<typename Callable>
+void yui::layout::HitGrid::for_each_cell(const Rect &rect, Callable &&callable) {
+    // hit_test() includes the right and bottom edges.
+    for (auto y = cell_of(rect.top); y <= cell_of(rect.bottom); ++y) {
+        for (auto x = cell_of(rect.left); x <= cell_of(rect.right); ++x) {
+            callable(cell_key(x, y));
+        }
+    }
+}
+
+void yui::layout::HitGrid::add(LayoutNode &node) {
+    for (auto *child : node.children()) {
+        add(*child);
+    }
+
+    m_entries.emplace_back(Entry{ .node = &node, .rect = node.absolute_rect() });
+    insert(static_cast<uint32_t>(m_entries.size() - 1));
+}
+
+void yui::layout::HitGrid::insert(uint32_t index) {
+    for_each_cell(m_entries[index].rect, [&](uint64_t key) {
+        auto &cell = m_cells[key];
+        cell.insert(std::lower_bound(cell.begin(), cell.end(), index), index);
+    });
+}
+
+void yui::layout::HitGrid::remove(uint32_t index) {
+    for_each_cell(m_entries[index].rect, [&](uint64_t key) {
+        const auto it = m_cells.find(key);
+
+        if (it == m_cells.end()) {
+            return;
+        }
+
+        auto &cell = it->second;
+        const auto position = std::lower_bound(cell.begin(), cell.end(), index);
+        if (position != cell.end() && *position == index) {
+            cell.erase(position);
+        }
+    });
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/vec2.hpp>
+#include "LayoutNode.h"
+
+namespace yui::layout {
+
+// Uniform grid over the absolute rects of a layout tree, so finding the node under a point only
+// hit tests the nodes overlapping one cell. Nodes are ordered children before their parent,
+// earlier siblings first, so the innermost, earliest node under the point wins.
+class HitGrid {
+public:
+    static constexpr int CELL_SIZE = 64;
+
+    // Indexes every node below `root` (not `root` itself), after the tree was constructed.
+    void rebuild(LayoutNode &root);
+    // Moves the nodes whose rect changed since the last call to their new cells, after a relayout.
+    void update();
+    void clear();
+
+    // The node the cursor is over, or nullptr.
+    [[nodiscard]] LayoutNode *hit(glm::ivec2 point) const;
+private:
+    struct Entry {
+        LayoutNode *node{ nullptr };
+        Rect rect{ };
+    };
+    // Indices into m_entries, ascending.
+    using Cell = std::vector<uint32_t>;
+
+    static int cell_of(int coordinate);
+    static uint64_t cell_key(int x, int y);
+    template<typename Callable>
+    static void for_each_cell(const Rect &, Callable &&);
+    void add(LayoutNode &node);
+    void insert(uint32_t index);
+    void remove(uint32_t index);
+private:
+    std::vector<Entry> m_entries{ };
+    std::unordered_map<uint64_t, Cell> m_cells{ };
+};
+
+}
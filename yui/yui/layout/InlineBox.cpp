@@ -7,7 +7,7 @@ void yui::layout::InlineBox::paint(yui::Painter &painter) {
     PainterUtilities::paint_background(painter, *this);
     PainterUtilities::paint_borders(painter, *this);
     for (auto &child : m_children) {
-        child->paint(painter);
+        child->paint_cached(painter);
     }
 }
 
@@ -18,7 +18,7 @@ void yui::layout::InlineCompute::compute(LayoutNode *node) {
         return;
     }
 
-    node->set_size(node->document_widget()->window()->painter().text_size(text, *font));
+    node->set_size(node->document_widget()->measure_text(text, *font, *node));
 }
 
 void yui::layout::InlineCompute::compute_inline_box(LayoutNode *node) {
@@ -62,11 +62,22 @@ void yui::layout::Input::paint(yui::Painter &painter) {
 }
 
 void yui::layout::Input::update(float dt) {
+    const auto caret_was_visible = m_caret_beam <= 0.5f;
     m_caret_beam += dt;
 
     if (m_caret_beam > 1.0f) {
         m_caret_beam = 0.0f;
     }
+
+    // Only repaint when the caret actually blinks.
+    if (dom_node()->focused()) {
+        if (caret_was_visible != (m_caret_beam <= 0.5f)) {
+            mark_paint_dirty();
+        }
+
+        const auto next_blink = m_caret_beam <= 0.5f ? 0.5f - m_caret_beam : 1.0f - m_caret_beam;
+        document_widget()->window()->request_redraw_after(next_blink + 0.001f);
+    }
 }
 
 void yui::layout::Input::compute() {
@@ -81,7 +92,7 @@ void yui::layout::Input::compute() {
 
     auto *font = PainterUtilities::get_font(*this);
     assert(font);
-    m_character_size = document_widget()->window()->painter().text_size(")", *font);
+    m_character_size = document_widget()->measure_text(")", *font, *this);
 
     m_size_value = size;
     m_size.x = m_character_size.x * size;
@@ -98,7 +109,11 @@ void yui::layout::Input::compute() {
 
 bool yui::layout::Input::on_key_down(int key, int scan, int mods) {
     if (dom_node()->focused()) {
-        return handle_key_down(key, scan, mods);
+        const auto handled = handle_key_down(key, scan, mods);
+        if (handled) {
+            mark_paint_dirty();
+        }
+        return handled;
     }
 
     return false;
@@ -106,7 +121,11 @@ bool yui::layout::Input::on_key_down(int key, int scan, int mods) {
 
 bool yui::layout::Input::on_key_up(int key, int scan, int mods) {
     if (dom_node()->focused()) {
-        return handle_key_up(key, scan, mods);
+        const auto handled = handle_key_up(key, scan, mods);
+        if (handled) {
+            mark_paint_dirty();
+        }
+        return handled;
     }
 
     return false;
@@ -114,7 +133,11 @@ bool yui::layout::Input::on_key_up(int key, int scan, int mods) {
 
 bool yui::layout::Input::on_input(int code_point) {
     if (dom_node()->focused()) {
-        return handle_input(code_point);
+        const auto handled = handle_input(code_point);
+        if (handled) {
+            mark_paint_dirty();
+        }
+        return handled;
     }
 
     return false;
@@ -172,4 +195,5 @@ yui::layout::TextPosition yui::layout::Input::screen_to_position(glm::ivec2 pt)
 
 void yui::layout::Input::on_click(glm::ivec2 mouse_position) {
     m_caret = screen_to_position(mouse_position);
+    mark_paint_dirty();
 }
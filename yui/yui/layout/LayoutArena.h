@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "Box.h"
+#include "Inline.h"
+#include "InlineBox.h"
+#include "Input.h"
+#include "Textarea.h"
+
+namespace yui::layout {
+
+// Fixed size chunks of T, handed out in order. clear() destroys the objects but keeps the chunks,
+// so the next tree is built in the same memory without going through the allocator.
+template<typename T>
+class LayoutPool {
+public:
+    LayoutPool() = default;
+    LayoutPool(const LayoutPool &) = delete;
+    LayoutPool(LayoutPool &&) = delete;
+    ~LayoutPool() { clear(); }
+
+    template<typename... Args>
+    T *create(Args &&... args) {
+        if (m_size == m_chunks.size() * CHUNK_SIZE) {
+            m_chunks.emplace_back(new Slot[CHUNK_SIZE]);
+        }
+
+        auto *slot = &m_chunks[m_size / CHUNK_SIZE][m_size % CHUNK_SIZE];
+        auto *object = new(slot->bytes) T(std::forward<Args>(args)...);
+        ++m_size;
+        return object;
+    }
+
+    void clear() {
+        while (m_size > 0) {
+            --m_size;
+            std::destroy_at(std::launder(reinterpret_cast<T *>(m_chunks[m_size / CHUNK_SIZE][m_size % CHUNK_SIZE].bytes)));
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return m_size; }
+private:
+    static constexpr size_t CHUNK_SIZE = 128;
+
+    struct Slot {
+        alignas(T) std::byte bytes[sizeof(T)];
+    };
+private:
+    std::vector<std::unique_ptr<Slot[]>> m_chunks{ };
+    size_t m_size{ 0 };
+};
+
+// Owns every layout node of a DocumentWidget, one pool per node type. Nodes are created while
+// the tree is constructed depth first, so siblings and subtrees end up next to each other.
+class LayoutArena {
+public:
+    template<typename T, typename... Args>
+    T *create(Args &&... args) {
+        return std::get<LayoutPool<T>>(m_pools).create(std::forward<Args>(args)...);
+    }
+
+    // Destroys every node, the memory is kept for the next tree.
+    void clear() {
+        std::apply([](auto &... pool) { (pool.clear(), ...); }, m_pools);
+    }
+private:
+    std::tuple<LayoutPool<Box>, LayoutPool<Inline>, LayoutPool<InlineBox>, LayoutPool<Input>, LayoutPool<Textarea>> m_pools{ };
+};
+
+}
@@ -18,15 +18,92 @@ void yui::layout::LayoutNode::update(float dt) {
     }
 }
 
+void yui::layout::LayoutNode::paint_cached(yui::Painter &painter) {
+    auto &draw_list = painter.draw_list();
+
+    if (!subtree_needs_repaint()) {
+        draw_list.append(m_display_list);
+        return;
+    }
+
+    const auto mark = draw_list.mark();
+    paint(painter);
+    draw_list.capture(mark, m_display_list);
+
+    m_painted_rect = paint_bounds();
+    m_has_been_painted = true;
+    clear_repaint_flags();
+}
+
+void yui::layout::LayoutNode::mark_paint_dirty() {
+    mark_subtree_paint_dirty();
+
+    for (auto *node = m_parent; node != nullptr; node = node->parent()) {
+        node->m_child_needs_repaint = true;
+    }
+}
+
+void yui::layout::LayoutNode::mark_subtree_paint_dirty() {
+    m_needs_repaint = true;
+    m_child_needs_repaint = true;
+
+    for (auto *child : m_children) {
+        child->mark_subtree_paint_dirty();
+    }
+}
+
+void yui::layout::LayoutNode::mark_self_paint_dirty() {
+    m_needs_repaint = true;
+
+    for (auto *node = m_parent; node != nullptr; node = node->parent()) {
+        node->m_child_needs_repaint = true;
+    }
+}
+
+void yui::layout::LayoutNode::clear_repaint_flags() {
+    m_needs_repaint = false;
+    m_child_needs_repaint = false;
+
+    // Children that this node's paint() doesn't paint would otherwise stay dirty forever.
+    for (auto *child : m_children) {
+        if (child->subtree_needs_repaint()) {
+            child->clear_repaint_flags();
+        }
+    }
+}
+
 void yui::layout::LayoutNode::compute() {
     for (auto *child : m_children) {
-        child->set_position(
-                {
-                        child->dom_node()->computed().margin().left,
-                        child->dom_node()->computed().margin().top
-                }
-        );
-        child->compute();
+        const auto margin = child->dom_node()->computed().margin();
+        child->set_position({ margin.left, margin.top });
+        child->layout();
+    }
+}
+
+void yui::layout::LayoutNode::layout() {
+    if (!subtree_needs_layout()) {
+        return;
+    }
+
+    compute();
+    m_needs_layout = false;
+    m_child_needs_layout = false;
+    mark_subtree_paint_dirty();
+}
+
+void yui::layout::LayoutNode::mark_needs_layout() {
+    m_needs_layout = true;
+
+    for (auto *node = m_parent; node != nullptr && !node->m_child_needs_layout; node = node->parent()) {
+        node->m_child_needs_layout = true;
+    }
+}
+
+void yui::layout::LayoutNode::mark_subtree_needs_layout() {
+    mark_needs_layout();
+
+    for (auto *child : m_children) {
+        child->mark_subtree_needs_layout();
     }
 }
 
@@ -35,9 +112,29 @@ void yui::layout::LayoutNode::set_size(glm::ivec2 size) {
 }
 
 void yui::layout::LayoutNode::set_position(glm::ivec2 pos) {
+    if (pos == m_position) {
+        return;
+    }
+
+    // Children were laid out relative to the old position, unless compute() is about to do it again.
+    if (!m_needs_layout) {
+        for (auto *child : m_children) {
+            child->translate(pos - m_position);
+        }
+        mark_subtree_paint_dirty();
+    }
+
     m_position = pos;
 }
 
+void yui::layout::LayoutNode::translate(glm::ivec2 delta) {
+    m_position += delta;
+
+    for (auto *child : m_children) {
+        child->translate(delta);
+    }
+}
+
 glm::ivec2 yui::layout::LayoutNode::inner_position() const {
     const auto padding = dom_node()->computed().padding();
     return m_position + glm::ivec2{ padding.x, padding.y };
@@ -53,6 +150,19 @@ glm::ivec2 yui::layout::LayoutNode::size_with_padding() const {
     return m_size + glm::ivec2{ padding.x * 2, padding.y * 2 };
 }
 
+yui::layout::Rect yui::layout::LayoutNode::paint_bounds() const {
+    // outline_rect() grows by the border width on both ends.
+    const auto overflow = dom_node() ? dom_node()->computed().border().width * 2 + 1 : 0;
+    const auto rect = absolute_rect();
+
+    return {
+            .top = rect.top - overflow,
+            .left = rect.left - overflow,
+            .bottom = rect.bottom + overflow,
+            .right = rect.right + overflow
+    };
+}
+
 void yui::layout::LayoutNode::set_dom_node(Node *dom_node) {
     m_dom_node = dom_node;
 }
@@ -166,59 +276,6 @@ bool yui::layout::LayoutNode::on_key_up(int key, int scan, int mods) {
     return false;
 }
 
-bool yui::layout::LayoutNode::on_mouse_move(glm::ivec2 pt) {
-    for (auto *child : m_children) {
-        if (child->on_mouse_move(pt)) {
-            return true;
-        }
-    }
-
-    // This is the currently hovered element
-    if (hit_test(pt.x, pt.y)) {
-        dom_node()->set_hovered(true);
-        document_widget()->invalidate_node(*this);
-        on_mouse_enter();
-        return true;
-    }
-
-    if (dom_node()->set_hovered(false)) {
-        document_widget()->invalidate_node(*this);
-        on_mouse_leave();
-    }
-    return false;
-}
-
-bool yui::layout::LayoutNode::on_left_mouse_down(glm::ivec2 pt) {
-    if (!hit_test(pt.x, pt.y)) {
-        return false;
-    }
-
-    for (auto *child : m_children) {
-        if (child->on_left_mouse_down(pt)) {
-            return true;
-        }
-    }
-
-    return true;
-}
-
-bool yui::layout::LayoutNode::on_left_mouse_up(glm::ivec2 pt) {
-    if (!hit_test(pt.x, pt.y)) {
-        return false;
-    }
-
-    for (auto *child : m_children) {
-        if (child->on_left_mouse_up(pt)) {
-            return true;
-        }
-    }
-
-    dom_node()->set_focused(true);
-    document_widget()->invalidate_node(*this);
-    on_click(pt);
-    return true;
-}
-
 void yui::layout::LayoutNode::update_siblings() {
     for (auto i = 0u; i < m_children.size(); ++i) {
         auto *prev = i == 0 ? nullptr : children().at(i - 1);
@@ -17,6 +17,8 @@ struct Rect {
 };
 
 class LayoutNode {
+    // Delivers mouse enter/leave and clicks to the node its hit grid finds.
+    friend class DocumentWidget;
 public:
     using ChildIterator = std::vector<LayoutNode *>::iterator;
 
@@ -24,13 +26,28 @@ public:
     virtual ~LayoutNode() = default;
 
     virtual void paint(yui::Painter &) {}
+    // Re-emits the cached display list of this subtree, only calling paint() when this node or
+    // one of its descendants was marked dirty since it was last painted.
+    void paint_cached(yui::Painter &);
     virtual void update(float dt);
     // Compute widths & heights
     virtual void compute();
+    // compute() when this node or one of its descendants needs layout, otherwise the size and
+    // positions from the last time are still valid. Only touches this subtree, the caller tells
+    // the ancestors about the repaint (see DocumentWidget::relayout()).
+    void layout();
+
+    // Marks this node for layout, ancestors are told that one of their descendants needs it.
+    void mark_needs_layout();
+    // Marks this node and every descendant, e.g. after their styles were recalculated.
+    void mark_subtree_needs_layout();
+    [[nodiscard]] bool needs_layout() const { return m_needs_layout; }
+    [[nodiscard]] bool subtree_needs_layout() const { return m_needs_layout || m_child_needs_layout; }
 
     [[nodiscard]] uint32_t id() const { return m_id; }
 
     void set_size(glm::ivec2 size);
+    // Moving a node that is laid out moves its whole subtree along instead of laying it out again.
     void set_position(glm::ivec2 pos);
 
     // The total absolute rect of this element including padding and border.
@@ -54,6 +71,19 @@ public:
 
     [[nodiscard]] glm::ivec2 size_with_padding() const;
 
+    // The rect paint() may touch, borders are drawn slightly outside of absolute_rect().
+    [[nodiscard]] Rect paint_bounds() const;
+    // Where this node was when it was last painted (only valid if it has been painted).
+    [[nodiscard]] const Rect &painted_rect() const { return m_painted_rect; }
+    [[nodiscard]] bool has_been_painted() const { return m_has_been_painted; }
+
+    // Marks this subtree for repaint, ancestors are told their cached display lists are stale.
+    void mark_paint_dirty();
+    // Only this node paints again, its children re-emit their cached display lists.
+    void mark_self_paint_dirty();
+    [[nodiscard]] bool needs_repaint() const { return m_needs_repaint; }
+    [[nodiscard]] bool subtree_needs_repaint() const { return m_needs_repaint || m_child_needs_repaint; }
+
     void set_dom_node(Node *dom_node);
     [[nodiscard]] Node *dom_node() const { return m_dom_node; }
 
@@ -96,20 +126,21 @@ public:
     virtual bool on_key_down(int key, int scan, int mods);
     virtual bool on_key_up(int key, int scan, int mods);
 
-    // Return true to say "handled".
-    virtual bool on_mouse_move(glm::ivec2);
-    virtual bool on_left_mouse_down(glm::ivec2);
-    virtual bool on_left_mouse_up(glm::ivec2);
-
     [[nodiscard]] virtual const char *layout_name() const { return "LayoutNode"; }
 
 protected:
     virtual void on_mouse_enter() {}
     virtual void on_mouse_leave() {}
+    virtual void on_mouse_down(glm::ivec2 mouse_position) {}
     virtual void on_click(glm::ivec2 mouse_position) {}
 
 protected:
     void update_siblings();
+private:
+    void clear_repaint_flags();
+    // Leaves the ancestors alone, layout() may run on several subtrees at once.
+    void mark_subtree_paint_dirty();
+    void translate(glm::ivec2 delta);
 protected:
     uint32_t m_id{ };
     glm::ivec2 m_position{ };
@@ -124,6 +155,17 @@ protected:
 
     // Document
     DocumentWidget *m_document_widget{ nullptr };
+
+    // Incremental layout
+    bool m_needs_layout{ true };
+    bool m_child_needs_layout{ true };
+
+    // Retained painting
+    bool m_needs_repaint{ true };
+    bool m_child_needs_repaint{ true };
+    bool m_has_been_painted{ false };
+    Rect m_painted_rect{ };
+    DisplayList m_display_list{ };
 };
 
 }
@@ -80,11 +80,22 @@ void yui::layout::Textarea::paint(yui::Painter &painter) {
 }
 
 void yui::layout::Textarea::update(float dt) {
+    const auto caret_was_visible = m_caret_beam <= 0.5f;
     m_caret_beam += dt;
 
     if (m_caret_beam > 1.0f) {
         m_caret_beam = 0.0f;
     }
+
+    // Only repaint when the caret actually blinks.
+    if (dom_node()->focused()) {
+        if (caret_was_visible != (m_caret_beam <= 0.5f)) {
+            mark_paint_dirty();
+        }
+
+        const auto next_blink = m_caret_beam <= 0.5f ? 0.5f - m_caret_beam : 1.0f - m_caret_beam;
+        document_widget()->window()->request_redraw_after(next_blink + 0.001f);
+    }
 }
 
 void yui::layout::Textarea::compute() {
@@ -102,7 +113,7 @@ void yui::layout::Textarea::compute() {
         return;
     }
 
-    m_character_size = document_widget()->window()->painter().text_size(")", *font);
+    m_character_size = document_widget()->measure_text(")", *font, *this);
     m_size.x = m_columns * m_character_size.x;
     m_size.y = m_rows * m_character_size.y;
 
@@ -115,7 +126,11 @@ void yui::layout::Textarea::compute() {
 
 bool yui::layout::Textarea::on_input(int code_point) {
     if (dom_node()->focused()) {
-        return handle_input(code_point);
+        const auto handled = handle_input(code_point);
+        if (handled) {
+            mark_paint_dirty();
+        }
+        return handled;
     }
 
     return false;
@@ -123,14 +138,22 @@ bool yui::layout::Textarea::on_input(int code_point) {
 
 bool yui::layout::Textarea::on_key_down(int key, int scan, int mods) {
     if (dom_node()->focused()) {
-        return handle_key_down(key, scan, mods);
+        const auto handled = handle_key_down(key, scan, mods);
+        if (handled) {
+            mark_paint_dirty();
+        }
+        return handled;
     }
     return false;
 }
 
 bool yui::layout::Textarea::on_key_up(int key, int scan, int mods) {
     if (dom_node()->focused()) {
-        return handle_key_up(key, scan, mods);
+        const auto handled = handle_key_up(key, scan, mods);
+        if (handled) {
+            mark_paint_dirty();
+        }
+        return handled;
     }
 
     return false;
@@ -188,5 +211,6 @@ yui::layout::TextPosition yui::layout::Textarea::screen_to_position(glm::ivec2 p
 
 void yui::layout::Textarea::on_click(glm::ivec2 mouse_position) {
     m_caret = screen_to_position(mouse_position);
+    mark_paint_dirty();
 }
 
@@ -1,14 +1,19 @@
 #include "DocumentNode.h"
+#include <algorithm>
 #include <utility>
 #include <filesystem>
 #include "../Util.h"
+#include "../yss/Selector.h"
 #include "../yss/StylesheetParser.h"
 
 yui::Stylesheet::Stylesheet(std::vector<StylesheetDeclaration> declarations, std::string source_file)
         : m_declarations(std::move(declarations)), m_source_file(std::move(source_file)) {}
 
 yui::DocumentNode::DocumentNode()
-        : Node(nullptr, this) {
+        : Node(nullptr, nullptr) {
+    // Not passed to Node, the arena isn't constructed yet and the document's own attributes
+    // would outlive it.
+    set_document(this);
     set_tag_name(DocumentNode::DOCUMENT_TAG_NAME);
 }
 
@@ -60,6 +65,7 @@ bool yui::DocumentNode::load_stylesheet(const std::string &file) {
     }
 
     m_stylesheets.emplace_back(std::move(parser.declarations()), file);
+    index_stylesheets();
     return true;
 }
 
@@ -75,21 +81,121 @@ bool yui::DocumentNode::reload_stylesheet(const std::string &file) {
     }
 
     m_stylesheets.erase(it);
+    index_stylesheets();
     return load_stylesheet(file);
 }
 
-std::vector<yui::StylesheetDeclaration *> yui::DocumentNode::matching_styles(Node &node) {
-    std::vector<yui::StylesheetDeclaration *> result;
+void yui::DocumentNode::index_stylesheets() {
+    m_rule_index.clear();
+    m_class_dependencies.clear();
+    m_id_dependencies.clear();
+    m_has_sibling_selectors = false;
+    clear_style_sharing_cache();
 
+    // The cascade order is decided once here, matching only has to keep it.
+    std::vector<StylesheetDeclaration *> cascade{ };
     for (auto &stylesheet : m_stylesheets) {
         for (auto &decl : stylesheet.declarations()) {
-            if (decl.match(node)) {
-                result.emplace_back(&decl);
+            cascade.emplace_back(&decl);
+        }
+    }
+    std::stable_sort(cascade.begin(), cascade.end(), [](const auto *a, const auto *b) {
+        return a->weight() < b->weight();
+    });
+    for (uint32_t i = 0; i < cascade.size(); ++i) {
+        cascade[i]->set_cascade_order(i);
+    }
+
+    for (auto &stylesheet : m_stylesheets) {
+        for (auto &decl : stylesheet.declarations()) {
+            m_rule_index.add(decl);
+
+            for (const auto &selector : decl.selectors()) {
+                for (const auto &simple : selector.complex_selectors()) {
+                    if (simple.relation() == Selector::SimpleSelector::Relation::AdjacentSibling) {
+                        m_has_sibling_selectors = true;
+                    }
+
+                    for (const auto &part : simple.parts()) {
+                        if (part.is_class()) {
+                            m_class_dependencies.insert(part.value);
+                        } else if (part.is_id()) {
+                            m_id_dependencies.insert(part.value);
+                        }
+                    }
+                }
             }
         }
     }
+}
+
+const yui::Node *yui::DocumentNode::find_style_sharing_candidate(const Node &node) const {
+    if (m_has_sibling_selectors || node.parent() == nullptr || node.has_attribute("id")) {
+        return nullptr;
+    }
+
+    // Rules match on the ui state of the node itself.
+    if (node.hovered() || node.focused()) {
+        return nullptr;
+    }
+
+    for (const auto *candidate : m_style_sharing_cache) {
+        // Siblings have the same ancestors, so only the node's own tag, classes and attributes matter.
+        if (candidate != nullptr
+            && candidate->parent() == node.parent()
+            && candidate->tag_name() == node.tag_name()
+            && candidate->class_list() == node.class_list()
+            && candidate->attributes() == node.attributes()
+            && !candidate->hovered()
+            && !candidate->focused()) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+void yui::DocumentNode::clear_style_sharing_cache() {
+    m_style_sharing_cache.fill(nullptr);
+    m_style_sharing_next = 0;
+}
+
+void yui::DocumentNode::remember_for_style_sharing(const Node &node) {
+    if (node.has_attribute("id")) {
+        return;
+    }
+
+    m_style_sharing_cache[m_style_sharing_next] = &node;
+    m_style_sharing_next = (m_style_sharing_next + 1) % STYLE_SHARING_CACHE_SIZE;
+}
 
-    return result;
+bool yui::DocumentNode::style_depends_on_class(ClassName class_name) const {
+    return m_class_dependencies.contains(class_name);
+}
+
+bool yui::DocumentNode::style_depends_on_id(const std::string &id) const {
+    // Ids aren't interned until a selector mentions them.
+    const auto atom = Atom::find(id);
+    return !atom.empty() && m_id_dependencies.contains(atom);
+}
+
+void yui::DocumentNode::update_styles(std::vector<RestyledNode> &restyled) {
+    if (needs_style_recalc()) {
+        clear_style_sharing_cache();
+        recalc_styles(false, restyled);
+    }
+}
+
+const std::vector<yui::StylesheetDeclaration *> &yui::DocumentNode::matching_styles(Node &node) {
+    m_matching_styles.clear();
+
+    // Only the rules whose rightmost compound could match are tested.
+    m_rule_index.candidates(node, m_matching_styles);
+    m_ancestor_filter.prepare_for(node);
+    std::erase_if(m_matching_styles, [&](StylesheetDeclaration *decl) {
+        return !decl->match(node, &m_ancestor_filter);
+    });
+
+    return m_matching_styles;
 }
 
 void yui::DocumentNode::update_node_id_reference(const std::string &id, Node *node) {
@@ -109,7 +215,32 @@ void yui::DocumentNode::remove_existing_id_reference(Node *node) {
 }
 
 void yui::DocumentNode::set_current_ui_state_node(NodeUiState ui_state, Node *node) {
-    m_current_ui_nodes[ui_state] = node;
+    auto *&current = m_current_ui_nodes[ui_state];
+
+    if (current == node) {
+        return;
+    }
+
+    ui_state_changed(current, ui_state);
+    ui_state_changed(node, ui_state);
+    current = node;
+}
+
+void yui::DocumentNode::ui_state_changed(Node *node, NodeUiState ui_state) {
+    if (node == nullptr || ui_state == NodeUiState::None) {
+        return;
+    }
+
+    const auto hovered = ui_state == NodeUiState::Hovered;
+    const auto affects_self = hovered ? Node::AffectedByHover : Node::AffectedByFocus;
+    const auto affects_others = hovered ? Node::HoverAffectsOthers : Node::FocusAffectsOthers;
+
+    // Descendants and following siblings may match on this node's state, restyle the parent's subtree.
+    if (node->style_flags() & affects_others) {
+        (node->parent() != nullptr ? node->parent() : node)->set_needs_style_recalc(StyleChange::Subtree);
+    } else if (node->style_flags() & affects_self) {
+        node->set_needs_style_recalc(StyleChange::Self);
+    }
 }
 
 const yui::Node *yui::DocumentNode::current_ui_state_node(NodeUiState ui_state) const {
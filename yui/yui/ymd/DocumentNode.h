@@ -1,5 +1,10 @@
 #pragma once
+#include <array>
+#include <unordered_set>
 #include "Node.h"
+#include "NodeArena.h"
+#include "../yss/AncestorFilter.h"
+#include "../yss/RuleIndex.h"
 #include "../yss/StylesheetDeclaration.h"
 
 namespace yui {
@@ -23,6 +28,9 @@ public:
 public:
     DocumentNode();
 
+    // Nodes of this document are allocated here, see DocumentParser.
+    NodeArena &arena() { return m_arena; }
+
     Node *query(const Selector &selector);
     std::vector<Node *> query_all(const Selector &selector);
 
@@ -31,7 +39,20 @@ public:
     bool load_stylesheet(const std::string &file);
     bool reload_stylesheet(const std::string &file);
 
-    std::vector<StylesheetDeclaration *> matching_styles(Node &);
+    // In cascade order. The result is reused by the next call, don't hold on to it.
+    const std::vector<StylesheetDeclaration *> &matching_styles(Node &);
+
+    // Recalculates the styles invalidated by ui state, class or id changes since the last call.
+    void update_styles(std::vector<RestyledNode> &restyled);
+    // Holds the ancestors of the node being matched, compute_styles() pushes and pops while it descends.
+    AncestorFilter &ancestor_filter() { return m_ancestor_filter; }
+    // Recently styled nodes, a sibling that would match the same rules reuses their computed style.
+    [[nodiscard]] const Node *find_style_sharing_candidate(const Node &) const;
+    void remember_for_style_sharing(const Node &);
+    // The cache only lives for one style pass, nodes may be gone by the next one.
+    void clear_style_sharing_cache();
+    [[nodiscard]] bool style_depends_on_class(ClassName) const;
+    [[nodiscard]] bool style_depends_on_id(const std::string &) const;
 public:
     // Nodes
     void update_node_id_reference(const std::string &, Node *);
@@ -64,6 +85,12 @@ public:
     [[nodiscard]] const std::vector<Stylesheet> &stylesheets() const { return m_stylesheets; };
 
 private:
+    // Rebuilds the rule index and the class/id dependencies after stylesheets changed.
+    void index_stylesheets();
+    void ui_state_changed(Node *, NodeUiState);
+private:
+    // Declared first, so it outlives everything else that could point into it.
+    NodeArena m_arena{ };
     using NodeIdMap = std::map<std::string, Node *>;
     using NodeIdIterator = NodeIdMap::iterator;
     NodeIdMap m_id_map{ };
@@ -73,6 +100,17 @@ private:
             { NodeUiState::Focused, nullptr },
     };
     std::vector<Stylesheet> m_stylesheets{ };
+    RuleIndex m_rule_index{ };
+    AncestorFilter m_ancestor_filter{ };
+    std::vector<StylesheetDeclaration *> m_matching_styles{ };
+    static constexpr size_t STYLE_SHARING_CACHE_SIZE = 8;
+    std::array<const Node *, STYLE_SHARING_CACHE_SIZE> m_style_sharing_cache{ };
+    size_t m_style_sharing_next{ 0 };
+    // Adjacent sibling selectors can tell otherwise identical siblings apart.
+    bool m_has_sibling_selectors{ false };
+    // Every class and id any selector mentions.
+    std::unordered_set<Atom> m_class_dependencies{ };
+    std::unordered_set<Atom> m_id_dependencies{ };
 };
 
 }
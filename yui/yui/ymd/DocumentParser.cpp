@@ -92,7 +92,7 @@ void yui::DocumentParser::construct_tree() {
             break;
         case yui::DocumentTokenType::OpenTagClose: // >
         {
-            if (is_self_closing(m_working_stack.top()->tag_name())) {
+            if (is_self_closing(m_working_stack.top()->tag_name().str())) {
                 close_current_tag();
             } else {
                 will_change_state(ParserState::InTagBody);
@@ -137,7 +137,7 @@ void yui::DocumentParser::construct_tree() {
             } else {
                 auto *parent = working_parent();
 
-                if (m_buffer != parent->tag_name()) {
+                if (parent->tag_name() != m_buffer) {
                     omit_error(token, "Closing tag doesn't match the top of the working node stack. Closing anyway.");
                 }
 
@@ -158,8 +158,8 @@ void yui::DocumentParser::will_change_state(ParserState new_state) {
         yui::trim(m_buffer);
 
         if (!m_buffer.empty()) {
-            // Move the old fragment buffer into inserted node.
-            append_text_fragment(std::move(m_buffer));
+            // Copied into the document's arena, the buffer keeps its capacity for the next fragment.
+            append_text_fragment(m_buffer);
         }
     }
 
@@ -171,8 +171,8 @@ void yui::DocumentParser::change_state(ParserState new_state) {
     m_parser_state = new_state;
 }
 
-void yui::DocumentParser::append_text_fragment(std::string text) {
-    auto *fragment = new TextFragmentNode(working_parent(), m_document, std::move(text));
+void yui::DocumentParser::append_text_fragment(std::string_view text) {
+    auto *fragment = m_document->arena().create<TextFragmentNode>(working_parent(), m_document, text);
     working_parent()->append_child(fragment);
 }
 
@@ -186,7 +186,7 @@ void yui::DocumentParser::append_new_node(const DocumentToken &token) {
         omit_error(token, "Found another <doc> tag inside of an already opened document. Treating as regular node.");
     }
 
-    auto *node = new Node(working_parent(), m_document);
+    auto *node = m_document->arena().create<Node>(working_parent(), m_document);
     node->set_tag_name(token.content());
 
     // Add it to parent.
@@ -1,6 +1,7 @@
 #pragma once
 #include <stack>
 #include <string>
+#include <string_view>
 
 #include "DocumentLexer.h"
 
@@ -55,7 +56,7 @@ private:
     void will_change_state(ParserState);
     void change_state(ParserState);
 
-    void append_text_fragment(std::string);
+    void append_text_fragment(std::string_view);
     void append_new_node(const DocumentToken &token);
 
     // Get the current parent that is being built.
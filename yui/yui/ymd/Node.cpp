@@ -1,11 +1,13 @@
 #include "Node.h"
+#include <algorithm>
 
 #include "DocumentNode.h"
 #include "../Util.h"
 #include "../yss/StyleHelper.h"
 
 yui::Node::Node(Node *parent, DocumentNode *document)
-        : m_parent(parent), m_document(document) {
+        : m_parent(parent), m_document(document),
+          m_attributes(document != nullptr ? &document->arena() : std::pmr::get_default_resource()) {
 }
 
 bool yui::Node::has_attribute(const std::string &k) const {
@@ -30,42 +32,131 @@ void yui::Node::set_document(DocumentNode *document) {
     // TODO: Remove from possible old document
 }
 
-void yui::Node::set_tag_name(std::string tag_name) {
-    m_tag_name = std::move(tag_name);
+void yui::Node::set_tag_name(Atom tag_name) {
+    m_tag_name = tag_name;
 }
 
 void yui::Node::set_attribute(const std::string &key, std::string value) {
     if (key == "class") {
         add_class(std::move(value));
-    } else {
+    } else if (key == "id") {
+        const auto previous = has_attribute(key) ? attribute(key) : std::string{ };
         m_attributes[key] = std::move(value);
+        m_id = Atom{ m_attributes.at(key) };
+        document()->update_node_id_reference(m_attributes.at(key), this);
 
-        if (key == "id") {
-            document()->update_node_id_reference(m_attributes.at(key), this);
+        if (document()->style_depends_on_id(previous) || document()->style_depends_on_id(m_attributes.at(key))) {
+            set_needs_style_recalc(StyleChange::Subtree);
         }
+    } else {
+        m_attributes[key] = std::move(value);
     }
 }
 
 void yui::Node::compute_styles() {
-    const auto matching = m_document->matching_styles(*this);
-    const auto merged = StyleHelper::merge(matching);
+    // Flags are gathered again while matching, descendants set HoverAffectsOthers etc. on us afterwards.
+    m_style_flags = 0;
+    if (static_cast<Node *>(m_document) == this) {
+        m_document->clear_style_sharing_cache();
+    }
+
+    if (const auto *sibling = m_document->find_style_sharing_candidate(*this)) {
+        // Same rules match, the groups are shared instead of cascaded again.
+        m_style_flags = sibling->m_style_flags & (AffectedByHover | AffectedByFocus);
+        m_cascaded = sibling->m_cascaded;
+        m_computed = sibling->m_computed;
+    } else {
+        m_cascaded = cascade();
+        inherit_from_parent();
+        m_document->remember_for_style_sharing(*this);
+    }
+
+    if (!m_children.empty()) {
+        auto &filter = m_document->ancestor_filter();
+        filter.push(*this);
+        for (auto &child : m_children) {
+            child->compute_styles();
+        }
+        filter.pop(*this);
+    }
+
+    m_style_change = StyleChange::None;
+    m_child_needs_style_recalc = false;
+}
 
-    if (merged) {
-        m_computed = ImmutableComputedValues::immutable_from_style(*merged, *this);
+void yui::Node::recalc_styles(bool parent_inherited_changed, std::vector<RestyledNode> &restyled) {
+    if (m_style_change == StyleChange::Subtree) {
+        compute_styles();
+        restyled.emplace_back(
+                RestyledNode{
+                        .node = this,
+                        .effects = StylesheetPropertyEffect::Layout | StylesheetPropertyEffect::Inherit,
+                        .subtree = true
+                }
+        );
+        return;
     }
 
-    // Inherit parent styles first
-    if (m_parent) {
-        auto inherited = m_computed.mutable_();
-        inherited.inherit(m_parent->m_computed);
-        m_computed = inherited.immutable();
+    auto inherited_changed = false;
+    if (m_style_change == StyleChange::Self || parent_inherited_changed) {
+        const auto previous = m_computed;
+
+        if (m_style_change == StyleChange::Self) {
+            m_style_flags &= ~(AffectedByHover | AffectedByFocus);
+            m_cascaded = cascade();
+        }
+        inherit_from_parent();
+
+        const auto effects = m_computed.difference(previous);
+        if (effects != StylesheetPropertyEffect::None) {
+            restyled.emplace_back(RestyledNode{ .node = this, .effects = effects });
+            inherited_changed = has_effect(effects, StylesheetPropertyEffect::Inherit);
+        }
     }
 
-    for (auto &child : m_children) {
-        child->compute_styles();
+    if (inherited_changed || m_child_needs_style_recalc) {
+        for (auto *child : m_children) {
+            if (inherited_changed || child->needs_style_recalc()) {
+                child->recalc_styles(inherited_changed, restyled);
+            }
+        }
+    }
+
+    m_style_change = StyleChange::None;
+    m_child_needs_style_recalc = false;
+}
+
+void yui::Node::set_needs_style_recalc(StyleChange change) {
+    m_style_change = std::max(m_style_change, change);
+
+    for (auto *node = m_parent; node != nullptr && !node->m_child_needs_style_recalc; node = node->m_parent) {
+        node->m_child_needs_style_recalc = true;
     }
 }
 
+yui::ImmutableComputedValues yui::Node::cascade() {
+    const auto &matching = m_document->matching_styles(*this);
+
+    if (matching.empty()) {
+        return { };
+    }
+
+    MutableComputedValues computed{ };
+    StyleHelper::merge(matching, computed);
+    return computed.immutable();
+}
+
+void yui::Node::inherit_from_parent() {
+    if (m_parent == nullptr) {
+        m_computed = m_cascaded;
+        return;
+    }
+
+    auto inherited = m_cascaded.mutable_();
+    inherited.inherit(m_parent->m_computed);
+    m_computed = inherited.immutable();
+}
+
 void yui::Node::append_child(Node *node) {
     m_children.emplace_back(node);
 }
@@ -89,12 +180,8 @@ uint32_t yui::Node::index_of_child(Node *node) const {
     return static_cast<uint32_t>(-1);
 }
 
-bool yui::Node::has_class(const std::string &key) const {
-    return std::find_if(
-            m_class_list.begin(),
-            m_class_list.end(),
-            [&key](const auto &a) { return a == key; }
-    ) != m_class_list.end();
+bool yui::Node::has_class(ClassName class_name) const {
+    return std::binary_search(m_class_list.begin(), m_class_list.end(), class_name);
 }
 
 bool yui::Node::children_are_fragments() const {
@@ -107,12 +194,37 @@ bool yui::Node::children_are_fragments() const {
 }
 
 void yui::Node::add_class(std::string class_names) {
+    const auto insert = [this](ClassName class_name) {
+        const auto it = std::lower_bound(m_class_list.begin(), m_class_list.end(), class_name);
+
+        if (it == m_class_list.end() || *it != class_name) {
+            m_class_list.insert(it, class_name);
+            class_changed(class_name);
+        }
+    };
+
     if (class_names.find(' ') != std::string::npos) {
         for (auto &&name : yui::split(std::move(class_names), ' ')) {
-            m_class_list.emplace_back(std::move(name));
+            insert(name);
         }
     } else {
-        m_class_list.emplace_back(std::move(class_names));
+        insert(class_names);
+    }
+}
+
+void yui::Node::remove_class(ClassName class_name) {
+    const auto it = std::lower_bound(m_class_list.begin(), m_class_list.end(), class_name);
+
+    if (it != m_class_list.end() && *it == class_name) {
+        m_class_list.erase(it);
+        class_changed(class_name);
+    }
+}
+
+void yui::Node::class_changed(ClassName class_name) {
+    // Classes no selector mentions can't change anything.
+    if (m_document != nullptr && m_document->style_depends_on_class(class_name)) {
+        set_needs_style_recalc(StyleChange::Subtree);
     }
 }
 
@@ -152,6 +264,13 @@ bool yui::Node::focused() const {
     return document()->current_ui_state_node(NodeUiState::Focused) == this;
 }
 
-void yui::TextFragmentNode::set_text(std::string text) {
-    m_text = std::move(text);
+yui::TextFragmentNode::TextFragmentNode(Node *parent, DocumentNode *document, std::string_view text)
+        : Node(parent, document) {
+    set_tag_name(TEXT_FRAGMENT_TAG_NAME);
+    set_text(text);
+}
+
+void yui::TextFragmentNode::set_text(std::string_view text) {
+    // The previous text stays in the arena until the document goes away.
+    m_text = document()->arena().copy_string(text);
 }
@@ -1,20 +1,24 @@
 #pragma once
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <glm/vec2.hpp>
 
+#include "../Atom.h"
 #include "../yss/Computed.h"
 #include "../yss/StylesheetDeclaration.h"
 
 namespace yui {
 class DocumentNode;
 class Node;
-using AttributeMap = std::map<std::string, std::string>;
+// Allocated from the document's arena, see NodeArena.
+using AttributeMap = std::pmr::map<std::string, std::string>;
 using NodeList = std::vector<Node *>;
 
-using ClassName = std::string;
+using ClassName = Atom;
+// Kept sorted by atom id, so lookups are a binary search and lists compare element wise.
 using ClassList = std::vector<ClassName>;
 
 enum class NodeUiState {
@@ -23,6 +27,22 @@ enum class NodeUiState {
     Focused,
 };
 
+// How much of a node's style has to be recalculated by DocumentNode::update_styles().
+enum class StyleChange : uint8_t {
+    None,
+    Self, // Match this node's rules again, descendants only re-inherit (if anything inherited changed).
+    Subtree, // Match this node and everything below it again.
+};
+
+// A node whose computed values changed in DocumentNode::update_styles().
+struct RestyledNode {
+    Node *node{ nullptr };
+    // See ComputedValues::difference(), Paint alone when e.g. only a color changed.
+    StylesheetPropertyEffect effects{ StylesheetPropertyEffect::None };
+    // Every node below it may have changed as well.
+    bool subtree{ false };
+};
+
 class Node {
 public:
     explicit Node(Node *parent, DocumentNode *document = nullptr);
@@ -34,19 +54,39 @@ public:
     DocumentNode *document() { return m_document; }
     [[nodiscard]] const DocumentNode *document() const { return m_document; }
     [[nodiscard]] const NodeList &children() const { return m_children; }
-    [[nodiscard]] const std::string &tag_name() const { return m_tag_name; }
+    [[nodiscard]] Atom tag_name() const { return m_tag_name; }
+    // The id attribute, interned by set_attribute() so selectors compare it as an integer.
+    [[nodiscard]] Atom id() const { return m_id; }
     [[nodiscard]] const AttributeMap &attributes() const { return m_attributes; }
     [[nodiscard]] bool has_attribute(const std::string &) const;
     [[nodiscard]] const std::string &attribute(const std::string &) const;
     std::string &attribute(const std::string &);
     [[nodiscard]] const ImmutableComputedValues &computed() const { return m_computed; }
 
+    // Set by Selector::match, tells what a ui state change of this node can affect.
+    enum StyleFlags : uint8_t {
+        AffectedByHover = 1 << 0, // A :hover rule could match this node.
+        AffectedByFocus = 1 << 1,
+        HoverAffectsOthers = 1 << 2, // :hover on this node is part of a descendant/sibling's selector.
+        FocusAffectsOthers = 1 << 3,
+    };
+    [[nodiscard]] uint8_t style_flags() const { return m_style_flags; }
+    void add_style_flags(uint8_t flags) { m_style_flags |= flags; }
+
     // Setters
     void set_parent(Node *parent);
     void set_document(DocumentNode *document);
-    void set_tag_name(std::string);
+    void set_tag_name(Atom);
     void set_attribute(const std::string &, std::string);
+    // Matches and computes the style of this node and all of its descendants.
     virtual void compute_styles();
+    // Only recomputes what was marked with set_needs_style_recalc(), nodes whose computed
+    // values changed are added to `restyled` (a node stands in for its whole subtree on StyleChange::Subtree).
+    void recalc_styles(bool parent_inherited_changed, std::vector<RestyledNode> &restyled);
+    void set_needs_style_recalc(StyleChange);
+    [[nodiscard]] bool needs_style_recalc() const {
+        return m_style_change != StyleChange::None || m_child_needs_style_recalc;
+    }
 
     // Tree modifying functions
     void append_child(Node *);
@@ -58,10 +98,11 @@ public:
     void remove_node(Node *);
     uint32_t index_of_child(Node *) const;
 
-    [[nodiscard]] bool has_class(const std::string &) const;
+    [[nodiscard]] bool has_class(ClassName) const;
     [[nodiscard]] const ClassList &class_list() const { return m_class_list; }
     [[nodiscard]] bool children_are_fragments() const;
     void add_class(std::string);
+    void remove_class(ClassName);
 
     // Returns true if it changed anything, otherwise false
     bool set_hovered(bool value);
@@ -77,15 +118,25 @@ public:
     }
 
     [[nodiscard]] virtual bool is_fragment() const { return false; }
+private:
+    // The values of the matched rules, before inheriting anything from the parent.
+    [[nodiscard]] ImmutableComputedValues cascade();
+    void inherit_from_parent();
+    void class_changed(ClassName);
 private:
     Node *m_parent{ nullptr };
     DocumentNode *m_document{ nullptr };
     NodeList m_children{ };
-    std::string m_tag_name{ };
+    Atom m_tag_name{ };
+    Atom m_id{ };
     AttributeMap m_attributes{ };
     ClassList m_class_list{ };
     NodeUiState m_ui_state{ NodeUiState::None };
     ImmutableComputedValues m_computed{ };
+    ImmutableComputedValues m_cascaded{ };
+    uint8_t m_style_flags{ 0 };
+    StyleChange m_style_change{ StyleChange::None };
+    bool m_child_needs_style_recalc{ false };
 };
 
 class TextFragmentNode : public Node {
@@ -93,16 +144,14 @@ public:
     static constexpr auto TEXT_FRAGMENT_TAG_NAME = "#text-fragment";
 
 public:
-    TextFragmentNode(Node *parent, DocumentNode *document, std::string text)
-            : Node(parent, document), m_text(std::move(text)) {
-        set_tag_name(TEXT_FRAGMENT_TAG_NAME);
-    }
+    // The text is copied into the document's arena.
+    TextFragmentNode(Node *parent, DocumentNode *document, std::string_view text);
 
-    [[nodiscard]] const std::string &text() const { return m_text; }
-    void set_text(std::string);
+    [[nodiscard]] std::string_view text() const { return m_text; }
+    void set_text(std::string_view);
     [[nodiscard]] bool is_fragment() const override { return true; }
 private:
-    std::string m_text{ };
+    std::string_view m_text{ };
 };
 
 }
@@ -0,0 +1,46 @@
+#include "NodeArena.h"
+#include <cstring>
+
+yui::NodeArena::~NodeArena() {
+    for (auto *it = m_destructors; it != nullptr; it = it->next) {
+        it->destroy(it->object);
+    }
+}
+
+std::string_view yui::NodeArena::copy_string(std::string_view value) {
+    if (value.empty()) {
+        return { };
+    }
+
+    auto *data = static_cast<char *>(allocate(value.size(), alignof(char)));
+    std::memcpy(data, value.data(), value.size());
+    return { data, value.size() };
+}
+
+void *yui::NodeArena::do_allocate(size_t bytes, size_t alignment) {
+    auto space = static_cast<size_t>(m_end - m_cursor);
+    void *cursor = m_cursor;
+
+    if (m_cursor == nullptr || std::align(alignment, bytes, cursor, space) == nullptr) {
+        // Big allocations get a chunk of their own and leave the current one alone.
+        // Chunks aren't zeroed, everything placed in them is constructed anyway.
+        if (bytes + alignment > CHUNK_SIZE) {
+            auto &chunk = m_chunks.emplace_back(new std::byte[bytes + alignment]);
+            void *ptr = chunk.get();
+            space = bytes + alignment;
+            m_bytes_used += bytes;
+            return std::align(alignment, bytes, ptr, space);
+        }
+
+        auto &chunk = m_chunks.emplace_back(new std::byte[CHUNK_SIZE]);
+        m_cursor = chunk.get();
+        m_end = m_cursor + CHUNK_SIZE;
+        cursor = m_cursor;
+        space = CHUNK_SIZE;
+        std::align(alignment, bytes, cursor, space);
+    }
+
+    m_cursor = static_cast<std::byte *>(cursor) + bytes;
+    m_bytes_used += bytes;
+    return cursor;
+}
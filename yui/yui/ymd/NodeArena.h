@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace yui {
+
+// Bump allocator owned by a DocumentNode, backing its nodes, their attribute maps and text.
+// Nothing is freed before the arena is; then the objects made with create() are destroyed
+// (newest first) and the chunks are released in one go.
+class NodeArena final : public std::pmr::memory_resource {
+public:
+    NodeArena() = default;
+    NodeArena(const NodeArena &) = delete;
+    NodeArena(NodeArena &&) = delete;
+    ~NodeArena() override;
+
+    template<typename T, typename... Args>
+    T *create(Args &&... args) {
+        auto *object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            m_destructors = new(allocate(sizeof(Destructor), alignof(Destructor))) Destructor{
+                    .object = object,
+                    .destroy = [](void *ptr) { static_cast<T *>(ptr)->~T(); },
+                    .next = m_destructors,
+            };
+        }
+
+        return object;
+    }
+
+    // Copies `value` into the arena, the view is valid for as long as the arena is.
+    std::string_view copy_string(std::string_view value);
+
+    [[nodiscard]] size_t bytes_used() const { return m_bytes_used; }
+    [[nodiscard]] size_t chunk_count() const { return m_chunks.size(); }
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    // Memory is only given back when the arena goes away.
+    void do_deallocate(void *, size_t, size_t) override {}
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    struct Destructor {
+        void *object{ nullptr };
+        void (*destroy)(void *){ nullptr };
+        Destructor *next{ nullptr };
+    };
+
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+private:
+    std::vector<std::unique_ptr<std::byte[]>> m_chunks{ };
+    std::byte *m_cursor{ nullptr };
+    std::byte *m_end{ nullptr };
+    Destructor *m_destructors{ nullptr };
+    size_t m_bytes_used{ 0 };
+};
+
+}
@@ -0,0 +1,96 @@
+#include "AncestorFilter.h"
+#include <algorithm>
+#include "../ymd/Node.h"
+
+// Mixes the atom id (murmur3 finalizer), seeded differently per kind so "#a", ".a" and "a" don't share bits.
+static uint32_t hash_with_seed(yui::Atom value, uint32_t seed) {
+    auto hash = value.id() ^ seed;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+uint32_t yui::AncestorFilter::hash_tag(Atom tag) {
+    return hash_with_seed(tag, 0x1b873593u);
+}
+
+uint32_t yui::AncestorFilter::hash_id(Atom id) {
+    return hash_with_seed(id, 0xcc9e2d51u);
+}
+
+uint32_t yui::AncestorFilter::hash_class(Atom class_name) {
+    return hash_with_seed(class_name, 0xe6546b64u);
+}
+
+void yui::AncestorFilter::prepare_for(const Node &node) {
+    if (!m_stack.empty() && m_stack.back() == node.parent()) {
+        return;
+    }
+
+    if (m_stack.empty() && node.parent() == nullptr) {
+        return;
+    }
+
+    clear();
+    std::vector<const Node *> ancestors{ };
+    for (const auto *it = node.parent(); it != nullptr; it = it->parent()) {
+        ancestors.emplace_back(it);
+    }
+
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+        push(**it);
+    }
+}
+
+void yui::AncestorFilter::push(const Node &node) {
+    for_each_hash(node, [this](uint32_t hash) { add(hash); });
+    m_stack.emplace_back(&node);
+}
+
+void yui::AncestorFilter::pop(const Node &node) {
+    if (m_stack.empty() || m_stack.back() != &node) {
+        clear();
+        return;
+    }
+
+    for_each_hash(node, [this](uint32_t hash) { remove(hash); });
+    m_stack.pop_back();
+}
+
+void yui::AncestorFilter::clear() {
+    m_counters.fill(0);
+    m_stack.clear();
+}
+
+template<typename Callable>
+void yui::AncestorFilter::for_each_hash(const Node &node, Callable &&callable) {
+    callable(hash_tag(node.tag_name()));
+
+    if (!node.id().empty()) {
+        callable(hash_id(node.id()));
+    }
+
+    for (const auto &class_name : node.class_list()) {
+        callable(hash_class(class_name));
+    }
+}
+
+void yui::AncestorFilter::add(uint32_t hash) {
+    // Saturated counters are never decremented again, which only makes the filter less precise.
+    for (const auto index : { hash & MASK, (hash >> BITS) & MASK }) {
+        if (m_counters[index] != UINT8_MAX) {
+            ++m_counters[index];
+        }
+    }
+}
+
+void yui::AncestorFilter::remove(uint32_t hash) {
+    for (const auto index : { hash & MASK, (hash >> BITS) & MASK }) {
+        if (m_counters[index] != UINT8_MAX && m_counters[index] != 0) {
+            --m_counters[index];
+        }
+    }
+}
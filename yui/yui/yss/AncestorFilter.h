@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "../Atom.h"
+
+namespace yui {
+class Node;
+
+// Counting Bloom filter of the tag, id and class hashes of the ancestors of the node being
+// styled. When one of a selector's ancestor parts isn't in the filter, the selector can't
+// match and the parent walk is skipped. False positives only cost the walk, never a wrong result.
+class AncestorFilter {
+public:
+    static uint32_t hash_tag(Atom);
+    static uint32_t hash_id(Atom);
+    static uint32_t hash_class(Atom);
+
+    // Makes the filter hold exactly the ancestors of `node`. Cheap when it already does,
+    // e.g. while compute_styles() walks down the tree with push()/pop().
+    void prepare_for(const Node &node);
+    void push(const Node &);
+    void pop(const Node &);
+    void clear();
+
+    [[nodiscard]] bool might_contain(uint32_t hash) const {
+        return m_counters[hash & MASK] != 0 && m_counters[(hash >> BITS) & MASK] != 0;
+    }
+private:
+    static constexpr uint32_t BITS = 12;
+    static constexpr uint32_t MASK = (1u << BITS) - 1;
+
+    template<typename Callable>
+    static void for_each_hash(const Node &, Callable &&);
+    void add(uint32_t hash);
+    void remove(uint32_t hash);
+private:
+    std::array<uint8_t, 1u << BITS> m_counters{ };
+    std::vector<const Node *> m_stack{ }; // Root first.
+};
+
+}
@@ -1,146 +1,366 @@
 #include "Computed.h"
 
+#include <unordered_map>
+#include <vector>
 #include "StylesheetDeclaration.h"
 
-yui::ImmutableComputedValues yui::ComputedValues::immutable_from_style(
-        const StylesheetDeclaration &style,
-        Node &dom_node
-) {
-    auto str_to_display = [](const auto &str) -> ComputedDisplay {
-        if (str == "block") { return ComputedDisplay::Block; }
-        if (str == "inline") { return ComputedDisplay::Inline; }
-        if (str == "none") { return ComputedDisplay::None; }
+void yui::MutableComputedValues::apply(const StylesheetPropertyBlock &style) {
+    // Keywords are atoms, comparing them doesn't touch the strings.
+    static const Atom block{ "block" }, inline_{ "inline" }, none{ "none" };
+    static const Atom left{ "left" }, center{ "center" }, right{ "right" };
+    static const Atom rows{ "rows" }, columns{ "columns" };
+    static const Atom input{ "input" }, hand{ "hand" };
+
+    auto str_to_display = [&](Atom str) -> ComputedDisplay {
+        if (str == block) { return ComputedDisplay::Block; }
+        if (str == inline_) { return ComputedDisplay::Inline; }
+        if (str == none) { return ComputedDisplay::None; }
         return DefaultValues::display();
     };
 
-    auto str_to_align = [](const auto &str) -> ComputedAlign {
-        if (str == "left") { return ComputedAlign::Left; }
-        if (str == "center") { return ComputedAlign::Center; }
-        if (str == "right") { return ComputedAlign::Right; }
+    auto str_to_align = [&](Atom str) -> ComputedAlign {
+        if (str == left) { return ComputedAlign::Left; }
+        if (str == center) { return ComputedAlign::Center; }
+        if (str == right) { return ComputedAlign::Right; }
         return DefaultValues::text_align();
     };
 
-    auto str_to_layout = [](const auto &str) -> ComputedLayout {
-        if (str == "rows") { return ComputedLayout::Rows; }
-        if (str == "columns") { return ComputedLayout::Columns; }
+    auto str_to_layout = [&](Atom str) -> ComputedLayout {
+        if (str == rows) { return ComputedLayout::Rows; }
+        if (str == columns) { return ComputedLayout::Columns; }
         return DefaultValues::layout();
     };
 
-    auto str_to_cursor = [](const auto &str) -> ComputedCursorMode {
-        if (str == "input") { return ComputedCursorMode::Input; }
-        if (str == "hand") { return ComputedCursorMode::Hand; }
+    auto str_to_cursor = [&](Atom str) -> ComputedCursorMode {
+        if (str == input) { return ComputedCursorMode::Input; }
+        if (str == hand) { return ComputedCursorMode::Hand; }
         return ComputedCursorMode::None;
     };
 
     auto color_value = [&style](const auto &id) -> Color {
-        return dynamic_cast<const StylesheetColorValue &>(style.property(id)).color();
+        return style.get(id).color();
     };
 
     auto length_value = [&style](const auto &id) -> int {
-        return dynamic_cast<const StylesheetUnitSizeValue &>(style.property(id)).scalar();
+        return style.get(id).scalar();
     };
 
-    auto string_value = [&style](const auto &id) -> const std::string & {
-        return style.property(id).string();
+    auto string_value = [&style](const auto &id) -> Atom {
+        return style.get(id).keyword();
     };
 
-    MutableComputedValues computed{ };
+    auto &computed = *this;
 
     // Layout
-    if (style.has_property(StylesheetPropertyId::Display)) {
+    if (style.has(StylesheetPropertyId::Display)) {
         computed.set_display(str_to_display(string_value(StylesheetPropertyId::Display)));
     }
 
-    if (style.has_property(StylesheetPropertyId::Layout)) {
+    if (style.has(StylesheetPropertyId::Layout)) {
         computed.set_layout(str_to_layout(string_value(StylesheetPropertyId::Layout)));
     }
 
-    if (style.has_property(StylesheetPropertyId::MarginTop)) {
+    if (style.has(StylesheetPropertyId::MarginTop)) {
         computed.set_margin_top(length_value(StylesheetPropertyId::MarginTop));
     }
-    if (style.has_property(StylesheetPropertyId::MarginLeft)) {
+    if (style.has(StylesheetPropertyId::MarginLeft)) {
         computed.set_margin_left(length_value(StylesheetPropertyId::MarginLeft));
     }
-    if (style.has_property(StylesheetPropertyId::MarginBottom)) {
+    if (style.has(StylesheetPropertyId::MarginBottom)) {
         computed.set_margin_bottom(length_value(StylesheetPropertyId::MarginBottom));
     }
-    if (style.has_property(StylesheetPropertyId::MarginRight)) {
+    if (style.has(StylesheetPropertyId::MarginRight)) {
         computed.set_margin_right(length_value(StylesheetPropertyId::MarginRight));
     }
 
-    if (style.has_property(StylesheetPropertyId::PaddingX)) {
+    if (style.has(StylesheetPropertyId::PaddingX)) {
         computed.set_padding_x(length_value(StylesheetPropertyId::PaddingX));
     }
-    if (style.has_property(StylesheetPropertyId::PaddingY)) {
+    if (style.has(StylesheetPropertyId::PaddingY)) {
         computed.set_padding_y(length_value(StylesheetPropertyId::PaddingY));
     }
 
-    if (style.has_property(StylesheetPropertyId::Width)) {
+    if (style.has(StylesheetPropertyId::Width)) {
         computed.set_width(length_value(StylesheetPropertyId::Width));
     }
-    if (style.has_property(StylesheetPropertyId::Height)) {
+    if (style.has(StylesheetPropertyId::Height)) {
         computed.set_height(length_value(StylesheetPropertyId::Height));
     }
 
-    if (style.has_property(StylesheetPropertyId::MinWidth)) {
+    if (style.has(StylesheetPropertyId::MinWidth)) {
         computed.set_min_width(length_value(StylesheetPropertyId::MinWidth));
     }
-    if (style.has_property(StylesheetPropertyId::MinHeight)) {
+    if (style.has(StylesheetPropertyId::MinHeight)) {
         computed.set_min_height(length_value(StylesheetPropertyId::MinHeight));
     }
 
-    if (style.has_property(StylesheetPropertyId::MaxWidth)) {
+    if (style.has(StylesheetPropertyId::MaxWidth)) {
         computed.set_max_width(length_value(StylesheetPropertyId::MaxWidth));
     }
-    if (style.has_property(StylesheetPropertyId::MaxHeight)) {
+    if (style.has(StylesheetPropertyId::MaxHeight)) {
         computed.set_max_height(length_value(StylesheetPropertyId::MaxHeight));
     }
 
     // Appearance
-    if (style.has_property(StylesheetPropertyId::BackgroundColor)) {
+    if (style.has(StylesheetPropertyId::BackgroundColor)) {
         computed.set_background_color(color_value(StylesheetPropertyId::BackgroundColor));
     }
-    if (style.has_property(StylesheetPropertyId::BorderSize)) {
+    if (style.has(StylesheetPropertyId::BorderSize)) {
         computed.set_border_width(length_value(StylesheetPropertyId::BorderSize));
     }
-    if (style.has_property(StylesheetPropertyId::BorderColor)) {
+    if (style.has(StylesheetPropertyId::BorderColor)) {
         computed.set_border_color(color_value(StylesheetPropertyId::BorderColor));
     }
 
     // Text
-    if (style.has_property(StylesheetPropertyId::FontName)) {
+    if (style.has(StylesheetPropertyId::FontName)) {
         computed.set_font_name(string_value(StylesheetPropertyId::FontName));
     }
-    if (style.has_property(StylesheetPropertyId::FontSize)) {
+    if (style.has(StylesheetPropertyId::FontSize)) {
         computed.set_font_size(length_value(StylesheetPropertyId::FontSize));
     }
-    if (style.has_property(StylesheetPropertyId::TextColor)) {
+    if (style.has(StylesheetPropertyId::TextColor)) {
         computed.set_text_color(color_value(StylesheetPropertyId::TextColor));
     }
-    if (style.has_property(StylesheetPropertyId::TextAlign)) {
+    if (style.has(StylesheetPropertyId::TextAlign)) {
         computed.set_text_align(str_to_align(string_value(StylesheetPropertyId::TextAlign)));
     }
 
     // Misc
-    if (style.has_property(StylesheetPropertyId::Cursor)) {
+    if (style.has(StylesheetPropertyId::Cursor)) {
         computed.set_cursor(str_to_cursor(string_value(StylesheetPropertyId::Cursor)));
     }
-
-    return computed.immutable();
 }
 
 void yui::MutableComputedValues::inherit(const ImmutableComputedValues &other) {
-    if (!m_inherited.text.changed.color) {
-        m_inherited.text.color = other.text().color;
+    // Only write (and so clone the shared group) when something actually differs.
+    const auto &text = m_inherited->text;
+    if (!text.changed.color && text.color != other.text().color) {
+        inherited_for_write().text.color = other.text().color;
+    }
+    if (!text.changed.font_name && text.font_name != other.text().font_name) {
+        inherited_for_write().text.font_name = other.text().font_name;
+    }
+    if (!text.changed.font_size && text.font_size != other.text().font_size) {
+        inherited_for_write().text.font_size = other.text().font_size;
+    }
+
+    if (other.cursor() != ComputedCursorMode::None && m_inherited->cursor == ComputedCursorMode::None) {
+        inherited_for_write().cursor = other.cursor();
+    }
+}
+
+yui::InheritedStyle &yui::MutableComputedValues::inherited_for_write() {
+    if (m_inherited.use_count() != 1) {
+        m_inherited = std::make_shared<InheritedStyle>(*m_inherited);
+    }
+    return const_cast<InheritedStyle &>(*m_inherited);
+}
+
+yui::NonInheritedStyle &yui::MutableComputedValues::noninherited_for_write() {
+    if (m_noninherited.use_count() != 1) {
+        m_noninherited = std::make_shared<NonInheritedStyle>(*m_noninherited);
+    }
+    return const_cast<NonInheritedStyle &>(*m_noninherited);
+}
+
+namespace {
+
+// Hands out one shared instance per distinct value. Entries are weak, a group is freed once
+// the last computed style using it goes away.
+template<typename T>
+class StyleInterner {
+public:
+    std::shared_ptr<const T> intern(const std::shared_ptr<const T> &value) {
+        auto &bucket = m_table[value->hash()];
+        std::erase_if(bucket, [](const std::weak_ptr<const T> &entry) { return entry.expired(); });
+
+        for (const auto &entry : bucket) {
+            auto existing = entry.lock();
+            if (existing == value || *existing == *value) {
+                return existing;
+            }
+        }
+
+        bucket.emplace_back(value);
+        return value;
+    }
+private:
+    std::unordered_map<size_t, std::vector<std::weak_ptr<const T>>> m_table{ };
+};
+
+StyleInterner<yui::InheritedStyle> &inherited_interner() {
+    static StyleInterner<yui::InheritedStyle> interner{ };
+    return interner;
+}
+
+StyleInterner<yui::NonInheritedStyle> &noninherited_interner() {
+    static StyleInterner<yui::NonInheritedStyle> interner{ };
+    return interner;
+}
+
+void hash_combine(size_t &seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t hash_color(yui::Color color) {
+    return (static_cast<size_t>(color.r) << 24) | (color.g << 16) | (color.b << 8) | color.a;
+}
+
+}
+
+const std::shared_ptr<const yui::InheritedStyle> &yui::ComputedValues::default_inherited() {
+    static const auto defaults = inherited_interner().intern(std::make_shared<const InheritedStyle>());
+    return defaults;
+}
+
+const std::shared_ptr<const yui::NonInheritedStyle> &yui::ComputedValues::default_noninherited() {
+    static const auto defaults = noninherited_interner().intern(std::make_shared<const NonInheritedStyle>());
+    return defaults;
+}
+
+yui::ImmutableComputedValues yui::ComputedValues::immutable() const {
+    ImmutableComputedValues result{ *this };
+    auto &values = static_cast<ComputedValues &>(result);
+    values.m_inherited = inherited_interner().intern(m_inherited);
+    values.m_noninherited = noninherited_interner().intern(m_noninherited);
+    return result;
+}
+
+bool yui::InheritedStyle::operator==(const InheritedStyle &other) const {
+    return text.font_name == other.text.font_name
+           && text.font_size == other.text.font_size
+           && text.color == other.text.color
+           && text.character_spacing == other.text.character_spacing
+           && text.line_height == other.text.line_height
+           && text.changed.font_name == other.text.changed.font_name
+           && text.changed.font_size == other.text.changed.font_size
+           && text.changed.color == other.text.changed.color
+           && text.changed.character_spacing == other.text.changed.character_spacing
+           && text.changed.line_height == other.text.changed.line_height
+           && cursor == other.cursor
+           && changed.text == other.changed.text
+           && changed.cursor == other.changed.cursor;
+}
+
+size_t yui::InheritedStyle::hash() const {
+    auto seed = std::hash<Atom>()(text.font_name);
+    hash_combine(seed, static_cast<size_t>(text.font_size));
+    hash_combine(seed, hash_color(text.color));
+    hash_combine(seed, static_cast<size_t>(cursor));
+    return seed;
+}
+
+bool yui::NonInheritedStyle::operator==(const NonInheritedStyle &other) const {
+    return display == other.display
+           && layout == other.layout
+           && margin.top == other.margin.top
+           && margin.left == other.margin.left
+           && margin.bottom == other.margin.bottom
+           && margin.right == other.margin.right
+           && padding.x == other.padding.x
+           && padding.y == other.padding.y
+           && border.width == other.border.width
+           && border.color == other.border.color
+           && background_color == other.background_color
+           && text_align == other.text_align
+           && width == other.width
+           && height == other.height
+           && max_width == other.max_width
+           && max_height == other.max_height
+           && min_width == other.min_width
+           && min_height == other.min_height;
+}
+
+size_t yui::NonInheritedStyle::hash() const {
+    auto seed = static_cast<size_t>(display);
+    for (const auto value : { static_cast<int>(layout), margin.top, margin.left, margin.bottom, margin.right,
+                              padding.x, padding.y, border.width, static_cast<int>(text_align),
+                              width, height, max_width, max_height, min_width, min_height }) {
+        hash_combine(seed, static_cast<size_t>(value));
     }
-    if (!m_inherited.text.changed.font_name) {
-        m_inherited.text.font_name = other.text().font_name;
+    hash_combine(seed, hash_color(border.color));
+    hash_combine(seed, hash_color(background_color));
+    return seed;
+}
+
+bool yui::ComputedValues::inherited_equal(const ComputedValues &other) const {
+    if (m_inherited == other.m_inherited) {
+        return true;
     }
-    if (!m_inherited.text.changed.font_size) {
-        m_inherited.text.font_size = other.text().font_size;
+
+    const auto &a = m_inherited->text;
+    const auto &b = other.m_inherited->text;
+    return a.font_name == b.font_name
+           && a.font_size == b.font_size
+           && a.color == b.color
+           && m_inherited->cursor == other.m_inherited->cursor;
+}
+
+static bool computed_property_equal(yui::StylesheetPropertyId id, const yui::ComputedValues &a, const yui::ComputedValues &b) {
+    using Id = yui::StylesheetPropertyId;
+
+    switch (id) {
+    case Id::Display: return a.display() == b.display();
+    case Id::Cursor: return a.cursor() == b.cursor();
+    case Id::BackgroundColor: return a.background_color() == b.background_color();
+    case Id::TextColor: return a.text().color == b.text().color;
+    case Id::FontName: return a.text().font_name == b.text().font_name;
+    case Id::FontSize: return a.text().font_size == b.text().font_size;
+    case Id::BorderColor: return a.border().color == b.border().color;
+    case Id::BorderSize: return a.border().width == b.border().width;
+    case Id::TextAlign: return a.text_align() == b.text_align();
+    case Id::Layout: return a.layout() == b.layout();
+    case Id::MarginTop: return a.margin().top == b.margin().top;
+    case Id::MarginBottom: return a.margin().bottom == b.margin().bottom;
+    case Id::MarginLeft: return a.margin().left == b.margin().left;
+    case Id::MarginRight: return a.margin().right == b.margin().right;
+    case Id::PaddingX: return a.padding().x == b.padding().x;
+    case Id::PaddingY: return a.padding().y == b.padding().y;
+    case Id::Width: return a.width() == b.width();
+    case Id::Height: return a.height() == b.height();
+    case Id::MaxWidth: return a.max_width() == b.max_width();
+    case Id::MaxHeight: return a.max_height() == b.max_height();
+    case Id::MinWidth: return a.min_width() == b.min_width();
+    case Id::MinHeight: return a.min_height() == b.min_height();
+    case Id::Unknown: break;
+    }
+
+    return true;
+}
+
+yui::StylesheetPropertyEffect yui::ComputedValues::difference(const ComputedValues &other) const {
+    auto effects = StylesheetPropertyEffect::None;
+    const auto same_inherited = m_inherited == other.m_inherited;
+    const auto same_noninherited = m_noninherited == other.m_noninherited;
+
+    // Groups are interned, the same pointer means the same values.
+    if (same_inherited && same_noninherited) {
+        return effects;
     }
 
-    if (other.cursor() != ComputedCursorMode::None && m_inherited.cursor == ComputedCursorMode::None) {
-        m_inherited.cursor = other.cursor();
+    for (size_t i = 1; i <= STYLESHEET_PROPERTY_COUNT; ++i) {
+        const auto id = static_cast<StylesheetPropertyId>(i);
+        const auto effect = StylesheetDeclaration::property_effect(id);
+
+        // Inherited properties live in the inherited group, the rest in the other one.
+        if (has_effect(effect, StylesheetPropertyEffect::Inherit) ? same_inherited : same_noninherited) {
+            continue;
+        }
+
+        if (!computed_property_equal(id, *this, other)) {
+            effects |= effect;
+        }
     }
+
+    return effects;
+}
+
+bool yui::ComputedValues::operator==(const ComputedValues &other) const {
+    const auto &a = *m_inherited;
+    const auto &b = *other.m_inherited;
+    return inherited_equal(other)
+           && a.text.character_spacing == b.text.character_spacing
+           && a.text.line_height == b.text.line_height
+           && (m_noninherited == other.m_noninherited || *m_noninherited == *other.m_noninherited);
 }
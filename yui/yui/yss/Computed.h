@@ -1,10 +1,13 @@
 #pragma once
+#include <memory>
 #include <string>
+#include "../Atom.h"
 #include "../Painter.h"
 
 namespace yui {
 class Node;
-class StylesheetDeclaration;
+class StylesheetPropertyBlock;
+enum class StylesheetPropertyEffect : uint8_t;
 
 enum class ComputedDisplay {
     Block,
@@ -30,7 +33,7 @@ enum class ComputedCursorMode {
 };
 
 struct ComputedText {
-    std::string font_name{ };
+    Atom font_name{ };
     int font_size{ };
     Color color{ };
     int character_spacing{ };
@@ -78,52 +81,74 @@ public:
 class ImmutableComputedValues;
 class MutableComputedValues;
 
+// The values children inherit. Shared between all nodes with the same values, see ComputedValues.
+struct InheritedStyle {
+    ComputedText text{ DefaultValues::text() };
+    ComputedCursorMode cursor{ DefaultValues::cursor() };
+    struct {
+        bool text{ false };
+        bool cursor{ false };
+    } changed;
+
+    bool operator==(const InheritedStyle &) const;
+    [[nodiscard]] size_t hash() const;
+};
+
+struct NonInheritedStyle {
+    ComputedDisplay display{ DefaultValues::display() };
+    ComputedLayout layout{ DefaultValues::layout() };
+    ComputedMargin margin{ DefaultValues::margin() };
+    ComputedPadding padding{ DefaultValues::padding() };
+    ComputedBorder border{ DefaultValues::border() };
+    Color background_color{ DefaultValues::background_color() };
+    ComputedAlign text_align{ DefaultValues::text_align() };
+    int width{ 0 };
+    int height{ 0 };
+    int max_width{ 0 };
+    int max_height{ 0 };
+    int min_width{ 0 };
+    int min_height{ 0 };
+
+    bool operator==(const NonInheritedStyle &) const;
+    [[nodiscard]] size_t hash() const;
+};
+
+// Both groups are immutable and reference counted. Copying computed values only copies two pointers,
+// MutableComputedValues clones a group the first time it writes to it (copy-on-write) and immutable()
+// interns them, so nodes with equal styles end up pointing at the same groups.
 class ComputedValues {
 public:
-    static ImmutableComputedValues immutable_from_style(const StylesheetDeclaration &, Node &dom_node);
-
-    [[nodiscard]] ComputedText text() const { return m_inherited.text; }
-    [[nodiscard]] ComputedCursorMode cursor() const { return m_inherited.cursor; }
-    [[nodiscard]] ComputedDisplay display() const { return m_noninherited.display; }
-    [[nodiscard]] ComputedLayout layout() const { return m_noninherited.layout; }
-    [[nodiscard]] ComputedMargin margin() const { return m_noninherited.margin; }
-    [[nodiscard]] ComputedPadding padding() const { return m_noninherited.padding; }
-    [[nodiscard]] ComputedBorder border() const { return m_noninherited.border; }
-    [[nodiscard]] Color background_color() const { return m_noninherited.background_color; }
-    [[nodiscard]] ComputedAlign text_align() const { return m_noninherited.text_align; }
-    [[nodiscard]] int width() const { return m_noninherited.width; }
-    [[nodiscard]] int height() const { return m_noninherited.height; }
-    [[nodiscard]] int max_width() const { return m_noninherited.max_width; }
-    [[nodiscard]] int max_height() const { return m_noninherited.max_height; }
-    [[nodiscard]] int min_width() const { return m_noninherited.min_width; }
-    [[nodiscard]] int min_height() const { return m_noninherited.min_height; }
+    [[nodiscard]] const ComputedText &text() const { return m_inherited->text; }
+    [[nodiscard]] ComputedCursorMode cursor() const { return m_inherited->cursor; }
+    [[nodiscard]] ComputedDisplay display() const { return m_noninherited->display; }
+    [[nodiscard]] ComputedLayout layout() const { return m_noninherited->layout; }
+    [[nodiscard]] ComputedMargin margin() const { return m_noninherited->margin; }
+    [[nodiscard]] ComputedPadding padding() const { return m_noninherited->padding; }
+    [[nodiscard]] ComputedBorder border() const { return m_noninherited->border; }
+    [[nodiscard]] Color background_color() const { return m_noninherited->background_color; }
+    [[nodiscard]] ComputedAlign text_align() const { return m_noninherited->text_align; }
+    [[nodiscard]] int width() const { return m_noninherited->width; }
+    [[nodiscard]] int height() const { return m_noninherited->height; }
+    [[nodiscard]] int max_width() const { return m_noninherited->max_width; }
+    [[nodiscard]] int max_height() const { return m_noninherited->max_height; }
+    [[nodiscard]] int min_width() const { return m_noninherited->min_width; }
+    [[nodiscard]] int min_height() const { return m_noninherited->min_height; }
 
     [[nodiscard]] ImmutableComputedValues immutable() const;
     [[nodiscard]] MutableComputedValues mutable_() const;
+
+    // Only compares the values children inherit, see MutableComputedValues::inherit().
+    [[nodiscard]] bool inherited_equal(const ComputedValues &) const;
+    // The effects (see STYLESHEET_PROPERTIES_ENUMERATOR) of every property whose value differs, None when equal.
+    [[nodiscard]] StylesheetPropertyEffect difference(const ComputedValues &) const;
+    bool operator==(const ComputedValues &) const;
+    bool operator!=(const ComputedValues &other) const { return !(*this == other); }
 protected:
-    struct {
-        ComputedText text{ DefaultValues::text() };
-        ComputedCursorMode cursor{ DefaultValues::cursor() };
-        struct {
-            bool text{ false };
-            bool cursor{ false };
-        } changed;
-    } m_inherited;
-    struct {
-        ComputedDisplay display{ DefaultValues::display() };
-        ComputedLayout layout{ DefaultValues::layout() };
-        ComputedMargin margin{ DefaultValues::margin() };
-        ComputedPadding padding{ DefaultValues::padding() };
-        ComputedBorder border{ DefaultValues::border() };
-        Color background_color{ DefaultValues::background_color() };
-        ComputedAlign text_align{ DefaultValues::text_align() };
-        int width{ 0 };
-        int height{ 0 };
-        int max_width{ 0 };
-        int max_height{ 0 };
-        int min_width{ 0 };
-        int min_height{ 0 };
-    } m_noninherited;
+    static const std::shared_ptr<const InheritedStyle> &default_inherited();
+    static const std::shared_ptr<const NonInheritedStyle> &default_noninherited();
+
+    std::shared_ptr<const InheritedStyle> m_inherited{ default_inherited() };
+    std::shared_ptr<const NonInheritedStyle> m_noninherited{ default_noninherited() };
 };
 
 class ImmutableComputedValues final : public ComputedValues {
@@ -132,52 +157,59 @@ public:
 
 class MutableComputedValues final : public ComputedValues {
 public:
+    // Sets every property the block has, declarations are applied one after another in cascade order.
+    void apply(const StylesheetPropertyBlock &);
+
     void set_cursor(ComputedCursorMode cursor) {
-        m_inherited.cursor = cursor;
-        m_inherited.changed.cursor = true;
+        auto &inherited = inherited_for_write();
+        inherited.cursor = cursor;
+        inherited.changed.cursor = true;
     }
-    void set_display(ComputedDisplay display) { m_noninherited.display = display; }
-    void set_layout(ComputedLayout layout) { m_noninherited.layout = layout; }
-    void set_margin_top(int top) { m_noninherited.margin.top = top; }
-    void set_margin_left(int left) { m_noninherited.margin.left = left; }
-    void set_margin_bottom(int bottom) { m_noninherited.margin.bottom = bottom; }
-    void set_margin_right(int right) { m_noninherited.margin.right = right; }
-    void set_margin(ComputedMargin margin) { m_noninherited.margin = margin; }
-    void set_padding_x(int x) { m_noninherited.padding.x = x; }
-    void set_padding_y(int y) { m_noninherited.padding.y = y; }
-    void set_padding(ComputedPadding padding) { m_noninherited.padding = padding; }
-    void set_font_name(std::string name) {
-        m_inherited.text.font_name = std::move(name);
-        m_inherited.changed.text = true;
-        m_inherited.text.changed.font_name = true;
+    void set_display(ComputedDisplay display) { noninherited_for_write().display = display; }
+    void set_layout(ComputedLayout layout) { noninherited_for_write().layout = layout; }
+    void set_margin_top(int top) { noninherited_for_write().margin.top = top; }
+    void set_margin_left(int left) { noninherited_for_write().margin.left = left; }
+    void set_margin_bottom(int bottom) { noninherited_for_write().margin.bottom = bottom; }
+    void set_margin_right(int right) { noninherited_for_write().margin.right = right; }
+    void set_margin(ComputedMargin margin) { noninherited_for_write().margin = margin; }
+    void set_padding_x(int x) { noninherited_for_write().padding.x = x; }
+    void set_padding_y(int y) { noninherited_for_write().padding.y = y; }
+    void set_padding(ComputedPadding padding) { noninherited_for_write().padding = padding; }
+    void set_font_name(Atom name) {
+        auto &inherited = inherited_for_write();
+        inherited.text.font_name = name;
+        inherited.changed.text = true;
+        inherited.text.changed.font_name = true;
     }
     void set_font_size(int size) {
-        m_inherited.text.font_size = size;
-        m_inherited.changed.text = true;
-        m_inherited.text.changed.font_size = true;
+        auto &inherited = inherited_for_write();
+        inherited.text.font_size = size;
+        inherited.changed.text = true;
+        inherited.text.changed.font_size = true;
     }
     void set_text_color(Color color) {
-        m_inherited.text.color = color;
-        m_inherited.changed.text = true;
-        m_inherited.text.changed.color = true;
+        auto &inherited = inherited_for_write();
+        inherited.text.color = color;
+        inherited.changed.text = true;
+        inherited.text.changed.color = true;
     }
-    void set_border_width(int width) { m_noninherited.border.width = width; }
-    void set_border_color(Color color) { m_noninherited.border.color = color; }
-    void set_background_color(Color color) { m_noninherited.background_color = color; }
-    void set_text_align(ComputedAlign align) { m_noninherited.text_align = align; }
-    void set_width(int width) { m_noninherited.width = width; }
-    void set_height(int height) { m_noninherited.height = height; }
-    void set_max_width(int width) { m_noninherited.max_width = width; }
-    void set_max_height(int height) { m_noninherited.max_height = height; }
-    void set_min_width(int width) { m_noninherited.min_width = width; }
-    void set_min_height(int height) { m_noninherited.min_height = height; }
+    void set_border_width(int width) { noninherited_for_write().border.width = width; }
+    void set_border_color(Color color) { noninherited_for_write().border.color = color; }
+    void set_background_color(Color color) { noninherited_for_write().background_color = color; }
+    void set_text_align(ComputedAlign align) { noninherited_for_write().text_align = align; }
+    void set_width(int width) { noninherited_for_write().width = width; }
+    void set_height(int height) { noninherited_for_write().height = height; }
+    void set_max_width(int width) { noninherited_for_write().max_width = width; }
+    void set_max_height(int height) { noninherited_for_write().max_height = height; }
+    void set_min_width(int width) { noninherited_for_write().min_width = width; }
+    void set_min_height(int height) { noninherited_for_write().min_height = height; }
     void inherit(const ImmutableComputedValues &);
+private:
+    // Clones the group unless this is the only reference to it.
+    InheritedStyle &inherited_for_write();
+    NonInheritedStyle &noninherited_for_write();
 };
 
-inline ImmutableComputedValues ComputedValues::immutable() const {
-    return { *this };
-}
-
 inline MutableComputedValues ComputedValues::mutable_() const {
     return { *this };
 }
@@ -0,0 +1,88 @@
+#include "RuleIndex.h"
+#include <algorithm>
+#include "StylesheetDeclaration.h"
+#include "../ymd/Node.h"
+
+void yui::RuleIndex::clear() {
+    m_by_id.clear();
+    m_by_class.clear();
+    m_by_tag.clear();
+    m_universal.clear();
+    m_size = 0;
+}
+
+void yui::RuleIndex::add(StylesheetDeclaration &declaration) {
+    const Entry entry{ .order = declaration.cascade_order(), .declaration = &declaration };
+    ++m_size;
+
+    for (const auto &selector : declaration.selectors()) {
+        if (selector.empty()) {
+            continue;
+        }
+
+        const Selector::SimpleSelector::Part *id = nullptr, *class_name = nullptr, *tag = nullptr;
+        auto invalid = false;
+        for (const auto &part : selector.complex_selectors().back().parts()) {
+            if (part.is_id()) {
+                id = &part;
+            } else if (part.is_class()) {
+                class_name = class_name != nullptr ? class_name : &part;
+            } else if (part.is_tag_name()) {
+                tag = &part;
+            } else if (!part.is_universal()) {
+                invalid = true;
+            }
+        }
+
+        // Can never match.
+        if (invalid) {
+            continue;
+        }
+
+        if (id != nullptr) {
+            m_by_id[id->value].emplace_back(entry);
+        } else if (class_name != nullptr) {
+            m_by_class[class_name->value].emplace_back(entry);
+        } else if (tag != nullptr) {
+            m_by_tag[tag->value].emplace_back(entry);
+        } else {
+            m_universal.emplace_back(entry);
+        }
+    }
+}
+
+void yui::RuleIndex::append(const Bucket &bucket, std::vector<Entry> &out) {
+    out.insert(out.end(), bucket.begin(), bucket.end());
+}
+
+void yui::RuleIndex::candidates(const Node &node, std::vector<StylesheetDeclaration *> &out) const {
+    m_scratch.clear();
+
+    if (!node.id().empty()) {
+        if (const auto it = m_by_id.find(node.id()); it != m_by_id.end()) {
+            append(it->second, m_scratch);
+        }
+    }
+
+    for (const auto &class_name : node.class_list()) {
+        if (const auto it = m_by_class.find(class_name); it != m_by_class.end()) {
+            append(it->second, m_scratch);
+        }
+    }
+
+    if (const auto it = m_by_tag.find(node.tag_name()); it != m_by_tag.end()) {
+        append(it->second, m_scratch);
+    }
+
+    append(m_universal, m_scratch);
+
+    // A declaration with several selectors can be in more than one bucket.
+    std::sort(m_scratch.begin(), m_scratch.end(), [](const Entry &a, const Entry &b) { return a.order < b.order; });
+    const auto last = std::unique(m_scratch.begin(), m_scratch.end(), [](const Entry &a, const Entry &b) {
+        return a.order == b.order;
+    });
+
+    for (auto it = m_scratch.begin(); it != last; ++it) {
+        out.emplace_back(it->declaration);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../Atom.h"
+
+namespace yui {
+class Node;
+class StylesheetDeclaration;
+
+// Buckets declarations by the rightmost compound of each of their selectors, by id, class
+// or tag name (in that order of preference), or in the universal bucket when it has none
+// of those. A node only has to be matched against the buckets it could possibly be in.
+class RuleIndex {
+public:
+    void clear();
+    // The declaration's cascade_order() has to be set.
+    void add(StylesheetDeclaration &);
+
+    // Every declaration that might match `node`, in cascade order.
+    void candidates(const Node &node, std::vector<StylesheetDeclaration *> &out) const;
+
+    [[nodiscard]] size_t size() const { return m_size; }
+private:
+    struct Entry {
+        uint32_t order{ 0 };
+        StylesheetDeclaration *declaration{ nullptr };
+    };
+    using Bucket = std::vector<Entry>;
+
+    static void append(const Bucket &, std::vector<Entry> &);
+private:
+    std::unordered_map<Atom, Bucket> m_by_id{ };
+    std::unordered_map<Atom, Bucket> m_by_class{ };
+    std::unordered_map<Atom, Bucket> m_by_tag{ };
+    Bucket m_universal{ };
+    size_t m_size{ 0 };
+    mutable std::vector<Entry> m_scratch{ };
+};
+
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <sstream>
 
+#include "AncestorFilter.h"
 #include "../ymd/DocumentNode.h"
 #include "../ymd/Node.h"
 
@@ -21,7 +22,7 @@ void yui::Selector::SimpleSelector::append(Part p) {
 }
 
 void yui::Selector::SimpleSelector::append(Type t, std::string s) {
-    m_parts.emplace_back(Part{ std::move(s), t });
+    m_parts.emplace_back(Part{ Atom{ s }, t });
 }
 
 void yui::Selector::SimpleSelector::set_relation(Relation relation) {
@@ -49,9 +50,35 @@ std::string yui::Selector::SimpleSelector::relation_to_string(Relation relation)
 
 void yui::Selector::append(SimpleSelector v) {
     m_complex_selectors.emplace_back(std::move(v));
+    compute_ancestor_hashes();
+    m_weight = compute_weight();
 }
 
-uint32_t yui::Selector::weight() const {
+void yui::Selector::compute_ancestor_hashes() {
+    m_ancestor_hashes.clear();
+
+    // A compound is an ancestor of the subject when the next one is its child or descendant,
+    // the one before an adjacent sibling relation is just a sibling.
+    for (size_t i = 0; i + 1 < m_complex_selectors.size(); ++i) {
+        const auto relation = m_complex_selectors[i + 1].relation();
+
+        if (relation != SimpleSelector::Relation::Descendant && relation != SimpleSelector::Relation::ImmediateChild) {
+            continue;
+        }
+
+        for (const auto &part : m_complex_selectors[i].parts()) {
+            if (part.is_tag_name()) {
+                m_ancestor_hashes.emplace_back(AncestorFilter::hash_tag(part.value));
+            } else if (part.is_id()) {
+                m_ancestor_hashes.emplace_back(AncestorFilter::hash_id(part.value));
+            } else if (part.is_class()) {
+                m_ancestor_hashes.emplace_back(AncestorFilter::hash_class(part.value));
+            }
+        }
+    }
+}
+
+uint32_t yui::Selector::compute_weight() const {
     auto weight = 0u;
 
     for (const auto &simple : m_complex_selectors) {
@@ -87,6 +114,18 @@ bool yui::Selector::match(Node &node) const {
     return match(node, m_complex_selectors.size() - 1);
 }
 
+bool yui::Selector::match(Node &node, const AncestorFilter *filter) const {
+    if (filter != nullptr) {
+        for (const auto hash : m_ancestor_hashes) {
+            if (!filter->might_contain(hash)) {
+                return false;
+            }
+        }
+    }
+
+    return match(node);
+}
+
 std::string yui::Selector::to_string() const {
     std::stringstream ss;
 
@@ -148,11 +187,7 @@ bool yui::Selector::match(Node &node, uint32_t selector_index) const {
             }
             break;
         case SimpleSelector::Type::Id:
-            if (!node.has_attribute("id")) {
-                return false;
-            }
-
-            if (node.attribute("id") != part.value) {
+            if (node.id().empty() || part.value != node.id()) {
                 return false;
             }
             break;
@@ -164,15 +199,19 @@ bool yui::Selector::match(Node &node, uint32_t selector_index) const {
         }
     }
 
+    // Everything but the state matched, so a state change of this node can change the result.
+    const auto is_subject = selector_index + 1 == m_complex_selectors.size();
     switch (selector.pseudo_class()) {
     case SimpleSelector::PseudoClass::None:
         break;
     case SimpleSelector::PseudoClass::Hover:
+        node.add_style_flags(is_subject ? Node::AffectedByHover : Node::HoverAffectsOthers);
         if (!node.hovered()) {
             return false;
         }
         break;
     case SimpleSelector::PseudoClass::Focus:
+        node.add_style_flags(is_subject ? Node::AffectedByFocus : Node::FocusAffectsOthers);
         if (!node.focused()) {
             return false;
         }
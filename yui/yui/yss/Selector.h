@@ -1,8 +1,10 @@
 #pragma once
 #include <string>
+#include "../Atom.h"
 #include <vector>
 
 namespace yui {
+class AncestorFilter;
 class Node;
 
 class Selector {
@@ -31,7 +33,7 @@ public:
         };
 
         struct Part {
-            std::string value{ };
+            Atom value{ };
             Type type{ Type::Invalid };
             [[nodiscard]] bool is_universal() const { return type == Type::Universal; }
             [[nodiscard]] bool is_tag_name() const { return type == Type::TagName; }
@@ -71,20 +73,29 @@ public:
 
     void append(SimpleSelector);
 
-    [[nodiscard]] uint32_t weight() const;
+    // Computed when a compound is appended, not while cascading.
+    [[nodiscard]] uint32_t weight() const { return m_weight; }
 
     [[nodiscard]] const ComplexSelectors &complex_selectors() const { return m_complex_selectors; }
     ComplexSelectors &complex_selectors() { return m_complex_selectors; }
 
     bool match(Node &) const;
+    // Rejects without walking up the tree when an ancestor part isn't in the filter,
+    // which has to hold the ancestors of the node (see AncestorFilter::prepare_for()).
+    bool match(Node &, const AncestorFilter *) const;
     [[nodiscard]] std::string to_string() const;
     [[nodiscard]] bool empty() const { return m_complex_selectors.empty(); }
 
 private:
     bool match(Node &, uint32_t selector_index) const;
+    void compute_ancestor_hashes();
+    [[nodiscard]] uint32_t compute_weight() const;
 
 private:
     ComplexSelectors m_complex_selectors{ };
+    // Tag, id and class hashes of every compound that has to match an ancestor of the subject.
+    std::vector<uint32_t> m_ancestor_hashes{ };
+    uint32_t m_weight{ 0 };
 };
 
 }
@@ -1,6 +1,7 @@
 #pragma once
-#include <memory>
+#include <vector>
 
+#include "Computed.h"
 #include "StylesheetDeclaration.h"
 
 namespace yui {
@@ -10,7 +11,8 @@ private:
     StyleHelper() = default;
 
 public:
-    static std::unique_ptr<StylesheetDeclaration> merge(std::vector<StylesheetDeclaration *> declarations);
+    // Applies `declarations` (already in cascade order, see DocumentNode::matching_styles()) to `computed`.
+    static void merge(const std::vector<StylesheetDeclaration *> &declarations, MutableComputedValues &computed);
 };
 
 }
@@ -1,32 +1,66 @@
 #include "StylesheetDeclaration.h"
 
+#include <algorithm>
 #include <cassert>
 #include <numeric>
+#include <type_traits>
 #include <utility>
+#include <fmt/format.h>
 
 #include "Selector.h"
 
-yui::StylesheetValue::StylesheetValue(std::string value)
-        : m_string(std::move(value)) {}
+static_assert(std::is_trivially_copyable_v<yui::StylesheetValue>);
 
-const std::string &yui::StylesheetValue::string() const { return m_string; }
+yui::StylesheetValue yui::StylesheetValue::parse(Kind kind, const std::string &value) {
+    switch (kind) {
+    case Kind::Color:
+        return from_color(to_color(value));
+    case Kind::Length: {
+        const auto [scalar, unit] = to_pair(value);
+        return from_length(scalar, unit);
+    }
+    case Kind::Keyword:
+        break;
+    }
+
+    return from_keyword(value);
+}
 
-void yui::StylesheetValue::set_string(std::string value) {
-    m_string = std::move(value);
+yui::StylesheetValue yui::StylesheetValue::from_keyword(Atom keyword) {
+    StylesheetValue value{ };
+    value.m_kind = Kind::Keyword;
+    value.m_keyword = keyword;
+    return value;
 }
 
-yui::StylesheetValue *yui::StylesheetValue::copy() const {
-    return new StylesheetValue(m_string);
+yui::StylesheetValue yui::StylesheetValue::from_color(Color color) {
+    StylesheetValue value{ };
+    value.m_kind = Kind::Color;
+    value.m_color = color;
+    return value;
 }
 
-yui::StylesheetColorValue::StylesheetColorValue(std::string value)
-        : StylesheetValue(std::move(value)), m_color(to_color(m_string)) {}
+yui::StylesheetValue yui::StylesheetValue::from_length(int scalar, Unit unit) {
+    StylesheetValue value{ };
+    value.m_kind = Kind::Length;
+    value.m_length = Length{ scalar, unit };
+    return value;
+}
 
-yui::StylesheetValue *yui::StylesheetColorValue::copy() const {
-    return new StylesheetColorValue(m_string);
+std::string yui::StylesheetValue::to_string() const {
+    switch (m_kind) {
+    case Kind::Color:
+        return fmt::format("#{:02x}{:02x}{:02x}{:02x}", m_color.r, m_color.g, m_color.b, m_color.a);
+    case Kind::Length:
+        return to_string(m_length.scalar, m_length.unit);
+    case Kind::Keyword:
+        break;
+    }
+
+    return m_keyword.str();
 }
 
-yui::Color yui::StylesheetColorValue::to_color(const std::string &hex_string) {
+yui::Color yui::StylesheetValue::to_color(const std::string &hex_string) {
     auto hex_color{ 0 };
     auto delta{ 0 };
 
@@ -54,45 +88,7 @@ yui::Color yui::StylesheetColorValue::to_color(const std::string &hex_string) {
     return color;
 }
 
-std::string yui::StylesheetColorValue::to_string(Color) {
-    return "";
-}
-
-yui::StylesheetUnitSizeValue::StylesheetUnitSizeValue(std::string value)
-        : StylesheetValue(std::move(value)) {
-    auto [scalar, unit] = to_pair(m_string);
-    m_scalar = scalar;
-    m_unit = unit;
-}
-
-yui::StylesheetUnitSizeValue::StylesheetUnitSizeValue(int scalar, Unit unit)
-        : m_scalar(scalar), m_unit(unit) {
-    m_string = to_string(m_scalar, m_unit);
-}
-
-void yui::StylesheetUnitSizeValue::set_string(std::string value) {
-    m_string = std::move(value);
-    // Set from value
-    auto [scalar, unit] = to_pair(m_string);
-    m_scalar = scalar;
-    m_unit = unit;
-}
-
-void yui::StylesheetUnitSizeValue::set_unit(Unit unit) {
-    if (m_unit != unit) {
-        m_unit = unit;
-        m_string = to_string(m_scalar, m_unit);
-    }
-}
-
-void yui::StylesheetUnitSizeValue::set_scalar(int scalar) {
-    if (m_scalar != scalar) {
-        m_scalar = scalar;
-        m_string = to_string(m_scalar, m_unit);
-    }
-}
-
-std::string yui::StylesheetUnitSizeValue::to_string(int scalar, Unit unit) {
+std::string yui::StylesheetValue::to_string(int scalar, Unit unit) {
     auto str = std::to_string(scalar);
 
     switch (unit) {
@@ -106,7 +102,7 @@ std::string yui::StylesheetUnitSizeValue::to_string(int scalar, Unit unit) {
     return str;
 }
 
-std::pair<int, yui::StylesheetUnitSizeValue::Unit> yui::StylesheetUnitSizeValue::to_pair(std::string string) {
+std::pair<int, yui::StylesheetValue::Unit> yui::StylesheetValue::to_pair(std::string string) {
     std::string number_part{ };
     number_part.reserve(string.length());
     for (auto it = string.begin(); it != string.end();) {
@@ -124,43 +120,16 @@ std::pair<int, yui::StylesheetUnitSizeValue::Unit> yui::StylesheetUnitSizeValue:
     return { number, Unit::Pixels };
 }
 
-yui::StylesheetValue *yui::StylesheetUnitSizeValue::copy() const {
-    return new StylesheetUnitSizeValue(m_scalar, m_unit);
-}
-
 yui::StylesheetDeclaration::StylesheetDeclaration(std::vector<Selector> selectors)
-        : m_selectors(std::move(selectors)) {}
+        : m_selectors(std::move(selectors)), m_weight(compute_weight()) {}
 
-yui::StylesheetDeclaration::StylesheetDeclaration(const StylesheetDeclaration &other)
-        : m_selectors(other.m_selectors) {
-    for (const auto &[id, ptr] : other.m_properties) {
-        m_properties[id] = ptr->copy();
-    }
-
-    for (const auto &[id, ptr] : other.m_custom_properties) {
-        m_custom_properties[id] = ptr->copy();
-    }
-}
-
-yui::StylesheetDeclaration::StylesheetDeclaration(StylesheetDeclaration &&other) noexcept
-        : m_selectors(std::move(other.m_selectors)), m_properties(std::move(other.m_properties)),
-          m_custom_properties(std::move(other.m_custom_properties)) {}
-
-yui::StylesheetDeclaration::~StylesheetDeclaration() {
-    for (auto [_, ptr] : m_properties) {
-        delete ptr;
-    }
-
-    for (auto [_, ptr] : m_custom_properties) {
-        delete ptr;
-    }
-
-    m_properties.clear();
-    m_custom_properties.clear();
+void yui::StylesheetDeclaration::set_selectors(std::vector<Selector> selectors) {
+    m_selectors = std::move(selectors);
+    m_weight = compute_weight();
 }
 
 bool yui::StylesheetDeclaration::match(Node &dom_node) const {
-    return match(dom_node, nullptr);
+    return match(dom_node, static_cast<const Selector **>(nullptr));
 }
 
 bool yui::StylesheetDeclaration::match(Node &dom_node, const Selector **first_matching_selector) const {
@@ -175,7 +144,13 @@ bool yui::StylesheetDeclaration::match(Node &dom_node, const Selector **first_ma
     return false;
 }
 
-uint32_t yui::StylesheetDeclaration::weight() const {
+bool yui::StylesheetDeclaration::match(Node &dom_node, const AncestorFilter *filter) const {
+    return std::any_of(m_selectors.cbegin(), m_selectors.cend(), [&](const Selector &selector) {
+        return selector.match(dom_node, filter);
+    });
+}
+
+uint32_t yui::StylesheetDeclaration::compute_weight() const {
     return std::accumulate(
             m_selectors.cbegin(),
             m_selectors.cend(),
@@ -187,7 +162,7 @@ uint32_t yui::StylesheetDeclaration::weight() const {
 }
 
 bool yui::StylesheetDeclaration::has_property(StylesheetPropertyId id) const {
-    return m_properties.find(id) != m_properties.end();
+    return id != StylesheetPropertyId::Unknown && m_properties.has(id);
 }
 
 bool yui::StylesheetDeclaration::has_property(const std::string &name) const {
@@ -201,79 +176,38 @@ bool yui::StylesheetDeclaration::has_property(const std::string &name) const {
 }
 
 const yui::StylesheetValue &yui::StylesheetDeclaration::property(StylesheetPropertyId id) const {
-    return *m_properties.at(id);
+    assert(has_property(id));
+    return m_properties.get(id);
 }
 
-const yui::StylesheetValue &yui::StylesheetDeclaration::property(const std::string &name) const {
-    const auto id = StylesheetDeclaration::property_id_from_string(name);
-
-    if (id != StylesheetPropertyId::Unknown) {
-        return property(id);
-    }
-
-    return *m_custom_properties.at(name);
+const std::string &yui::StylesheetDeclaration::custom_property(const std::string &name) const {
+    return m_custom_properties.at(name);
 }
 
 void yui::StylesheetDeclaration::set_property(StylesheetPropertyId id, std::string value) {
-    const auto iterator = m_properties.find(id);
-
-    if (iterator == m_properties.end()) {
-        m_properties[id] = create_stylesheet_value(id, std::move(value));
-    } else {
-        m_properties[id]->set_string(std::move(value));
-    }
+    set_property(id, StylesheetValue::parse(property_kind(id), value));
 }
 
-void yui::StylesheetDeclaration::set_property(const std::string &name, std::string value) {
-    const auto id = StylesheetDeclaration::property_id_from_string(name);
-
+void yui::StylesheetDeclaration::set_property(StylesheetPropertyId id, StylesheetValue value) {
     if (id != StylesheetPropertyId::Unknown) {
-        return set_property(id, std::move(value));
-    }
-
-    // Set?
-    const auto iterator = m_custom_properties.find(name);
-
-    if (iterator == m_custom_properties.end()) {
-        m_custom_properties[name] = new StylesheetValue(std::move(value));
-    } else {
-        m_custom_properties[name]->set_string(std::move(value));
+        m_properties.set(id, value);
     }
 }
 
-void yui::StylesheetDeclaration::set_property_ptr(StylesheetPropertyId id, StylesheetValue *value) {
-    const auto iterator = m_properties.find(id);
-
-    if (iterator != m_properties.end()) {
-        delete iterator->second;
-    }
-    m_properties[id] = value;
-}
-
-void yui::StylesheetDeclaration::set_property_ptr(const std::string &name, StylesheetValue *value) {
+void yui::StylesheetDeclaration::set_property(const std::string &name, std::string value) {
     const auto id = StylesheetDeclaration::property_id_from_string(name);
 
     if (id != StylesheetPropertyId::Unknown) {
-        return set_property_ptr(id, value);
+        return set_property(id, std::move(value));
     }
 
-    const auto iterator = m_custom_properties.find(name);
-
-    if (iterator != m_custom_properties.end()) {
-        delete iterator->second;
-    }
-    m_custom_properties[name] = value;
+    m_custom_properties[name] = std::move(value);
 }
 
 void yui::StylesheetDeclaration::unset_property(StylesheetPropertyId id) {
-    const auto iterator = m_properties.find(id);
-
-    if (iterator == m_properties.end()) {
-        return;
+    if (id != StylesheetPropertyId::Unknown) {
+        m_properties.unset(id);
     }
-
-    delete iterator->second;
-    m_properties.erase(iterator);
 }
 
 void yui::StylesheetDeclaration::unset_property(const std::string &name) {
@@ -283,14 +217,7 @@ void yui::StylesheetDeclaration::unset_property(const std::string &name) {
         return unset_property(id);
     }
 
-    const auto iterator = m_custom_properties.find(name);
-
-    if (iterator == m_custom_properties.end()) {
-        return;
-    }
-
-    delete iterator->second;
-    m_custom_properties.erase(iterator);
+    m_custom_properties.erase(name);
 }
 
 yui::StylesheetPropertyId yui::StylesheetDeclaration::property_id_from_string(const std::string &name) {
@@ -302,11 +229,31 @@ yui::StylesheetPropertyId yui::StylesheetDeclaration::property_id_from_string(co
     return StylesheetPropertyId::Unknown;
 }
 
-yui::StylesheetValue *yui::StylesheetDeclaration::create_stylesheet_value(StylesheetPropertyId id, std::string value) {
-#define STYLESHEET_PROPERTIES_ENUMERATOR_(a, b, c, className) if (id == StylesheetPropertyId::a) return new className(std::move(value));
+yui::StylesheetValue::Kind yui::StylesheetDeclaration::property_kind(StylesheetPropertyId id) {
+    switch (id) {
+#define STYLESHEET_PROPERTIES_ENUMERATOR_(a, b, c, kind, ...) \
+    case StylesheetPropertyId::a: return StylesheetValue::Kind::kind;
     STYLESHEET_PROPERTIES_ENUMERATOR
 #undef STYLESHEET_PROPERTIES_ENUMERATOR_
+    case StylesheetPropertyId::Unknown:
+        break;
+    }
+
+    return StylesheetValue::Kind::Keyword;
+}
+
+yui::StylesheetPropertyEffect yui::StylesheetDeclaration::property_effect(StylesheetPropertyId id) {
+    using enum StylesheetPropertyEffect;
+
+    switch (id) {
+#define STYLESHEET_PROPERTIES_ENUMERATOR_(a, b, c, kind, effect) \
+    case StylesheetPropertyId::a: return effect;
+    STYLESHEET_PROPERTIES_ENUMERATOR
+#undef STYLESHEET_PROPERTIES_ENUMERATOR_
+    case StylesheetPropertyId::Unknown:
+        break;
+    }
 
-    assert(1);
-    return nullptr;
+    // Custom properties don't end up in computed values.
+    return None;
 }
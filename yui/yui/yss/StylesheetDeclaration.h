@@ -1,35 +1,40 @@
 #pragma once
+#include <array>
+#include <bitset>
 #include <map>
 #include <string>
 #include "Selector.h"
+#include "../Atom.h"
 #include "../Painter.h"
 
 namespace yui {
+class AncestorFilter;
 class Selector;
 
+// Id, camel case name, stylesheet name, value kind and what a change of the computed value invalidates.
 #define STYLESHEET_PROPERTIES_ENUMERATOR \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(Display, display, display, StylesheetValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(Cursor, cursor, cursor, StylesheetValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(BackgroundColor, backgroundColor, background-color, StylesheetColorValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(TextColor, textColor, text-color, StylesheetColorValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(FontName, fontName, font-name, StylesheetValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(FontSize, fontSize, font-size, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(BorderColor, borderColor, border-color, StylesheetColorValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(BorderSize, borderSize, border-size, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(TextAlign, textAlign, text-align, StylesheetValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(Layout, layout, layout, StylesheetValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginTop, marginTop, margin-top, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginBottom, marginBottom, margin-bottom, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginLeft, marginLeft, margin-left, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginRight, marginRight, margin-right, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(PaddingX, paddingX, padding-x, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(PaddingY, paddingY, padding-y, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(Width, width, width, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(Height, height, height, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MaxWidth, maxWidth, max-width, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MaxHeight, maxHeight, max-height, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MinWidth, minWidth, min-width, StylesheetUnitSizeValue) \
-        STYLESHEET_PROPERTIES_ENUMERATOR_(MinHeight, minHeight, min-height, StylesheetUnitSizeValue)
+        STYLESHEET_PROPERTIES_ENUMERATOR_(Display, display, display, Keyword, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(Cursor, cursor, cursor, Keyword, Inherit) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(BackgroundColor, backgroundColor, background-color, Color, Paint) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(TextColor, textColor, text-color, Color, Paint | Inherit) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(FontName, fontName, font-name, Keyword, Layout | Inherit) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(FontSize, fontSize, font-size, Length, Layout | Inherit) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(BorderColor, borderColor, border-color, Color, Paint) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(BorderSize, borderSize, border-size, Length, Paint) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(TextAlign, textAlign, text-align, Keyword, Paint) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(Layout, layout, layout, Keyword, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginTop, marginTop, margin-top, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginBottom, marginBottom, margin-bottom, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginLeft, marginLeft, margin-left, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MarginRight, marginRight, margin-right, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(PaddingX, paddingX, padding-x, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(PaddingY, paddingY, padding-y, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(Width, width, width, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(Height, height, height, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MaxWidth, maxWidth, max-width, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MaxHeight, maxHeight, max-height, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MinWidth, minWidth, min-width, Length, Layout) \
+        STYLESHEET_PROPERTIES_ENUMERATOR_(MinHeight, minHeight, min-height, Length, Layout)
 
 // Standardized properties
 enum class StylesheetPropertyId {
@@ -39,99 +44,166 @@ enum class StylesheetPropertyId {
 #undef STYLESHEET_PROPERTIES_ENUMERATOR_
 };
 
-class StylesheetValue {
-public:
-    StylesheetValue() = default;
-    explicit StylesheetValue(std::string);
-    virtual ~StylesheetValue() = default;
-
-    [[nodiscard]] const std::string &string() const;
-    virtual void set_string(std::string);
-
-    [[nodiscard]] virtual StylesheetValue *copy() const;
-protected:
-    std::string m_string{ };
+static constexpr size_t STYLESHEET_PROPERTY_COUNT = 0
+#define STYLESHEET_PROPERTIES_ENUMERATOR_(...) + 1
+        STYLESHEET_PROPERTIES_ENUMERATOR
+#undef STYLESHEET_PROPERTIES_ENUMERATOR_
+;
+
+// What has to be redone when the computed value of a property changes.
+enum class StylesheetPropertyEffect : uint8_t {
+    None = 0,
+    Paint = 1 << 0, // Only the node itself is painted again.
+    Layout = 1 << 1, // The node is laid out again, which repaints it as well.
+    Inherit = 1 << 2, // Descendants inherit the value and have to inherit it again.
 };
 
-class StylesheetColorValue : public StylesheetValue {
-public:
-    explicit StylesheetColorValue(std::string);
+constexpr StylesheetPropertyEffect operator|(StylesheetPropertyEffect a, StylesheetPropertyEffect b) {
+    return static_cast<StylesheetPropertyEffect>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
 
-    [[nodiscard]] Color color() const { return m_color; }
+constexpr StylesheetPropertyEffect &operator|=(StylesheetPropertyEffect &a, StylesheetPropertyEffect b) {
+    return a = a | b;
+}
 
-    [[nodiscard]] StylesheetValue *copy() const override;
-    static Color to_color(const std::string &);
-    static std::string to_string(Color);
-private:
-    Color m_color{ };
-};
+constexpr bool has_effect(StylesheetPropertyEffect effects, StylesheetPropertyEffect effect) {
+    return (static_cast<uint8_t>(effects) & static_cast<uint8_t>(effect)) != 0;
+}
 
-class StylesheetUnitSizeValue : public StylesheetValue {
+// The value of a standard property, parsed once when the stylesheet is. Trivially copyable,
+// keywords and names are atoms, so copying a property block is a plain memberwise copy.
+class StylesheetValue {
 public:
-    enum class Unit {
+    enum class Kind : uint8_t {
+        Keyword,
+        Color,
+        Length,
+    };
+
+    enum class Unit : uint8_t {
         Pixels,
         Percentage,
     };
 
 public:
-    explicit StylesheetUnitSizeValue(std::string);
-    StylesheetUnitSizeValue(int, Unit);
-    void set_string(std::string) override;
+    StylesheetValue() : m_keyword() {}
+
+    static StylesheetValue parse(Kind, const std::string &);
+    static StylesheetValue from_keyword(Atom);
+    static StylesheetValue from_color(Color);
+    static StylesheetValue from_length(int scalar, Unit);
 
-    [[nodiscard]] Unit unit() const { return m_unit; }
-    [[nodiscard]] int scalar() const { return m_scalar; }
-    void set_unit(Unit);
-    void set_scalar(int);
+    [[nodiscard]] Kind kind() const { return m_kind; }
+    [[nodiscard]] Atom keyword() const { return m_kind == Kind::Keyword ? m_keyword : Atom{ }; }
+    [[nodiscard]] Color color() const { return m_kind == Kind::Color ? m_color : Color{ }; }
+    [[nodiscard]] int scalar() const { return m_kind == Kind::Length ? m_length.scalar : 0; }
+    [[nodiscard]] Unit unit() const { return m_kind == Kind::Length ? m_length.unit : Unit::Pixels; }
+    [[nodiscard]] std::string to_string() const;
 
+    static Color to_color(const std::string &);
     static std::string to_string(int, Unit);
     static std::pair<int, Unit> to_pair(std::string);
+private:
+    struct Length {
+        int scalar;
+        Unit unit;
+    };
 
-    [[nodiscard]] StylesheetValue *copy() const override;
+    Kind m_kind{ Kind::Keyword };
+    union {
+        Atom m_keyword;
+        Color m_color;
+        Length m_length;
+    };
+};
+
+// The standard properties of a declaration: which ones are set, and a slot for every property.
+// Merging blocks in cascade order is a bitwise or of the sets and a copy of the set slots.
+class StylesheetPropertyBlock {
+public:
+    [[nodiscard]] bool has(StylesheetPropertyId id) const { return m_present.test(index(id)); }
+    [[nodiscard]] const StylesheetValue &get(StylesheetPropertyId id) const { return m_values[index(id)]; }
+    void set(StylesheetPropertyId id, StylesheetValue value) {
+        m_present.set(index(id));
+        m_values[index(id)] = value;
+    }
+    void unset(StylesheetPropertyId id) { m_present.reset(index(id)); }
+    void clear() { m_present.reset(); }
+
+    [[nodiscard]] bool empty() const { return m_present.none(); }
+    [[nodiscard]] size_t size() const { return m_present.count(); }
+
+    // The properties `other` has replace ours.
+    void merge(const StylesheetPropertyBlock &other) {
+        for (size_t i = 0; i < STYLESHEET_PROPERTY_COUNT; ++i) {
+            if (other.m_present.test(i)) {
+                m_values[i] = other.m_values[i];
+            }
+        }
+        m_present |= other.m_present;
+    }
+
+    template<typename Callable>
+    void for_each(Callable &&callable) const {
+        for (size_t i = 0; i < STYLESHEET_PROPERTY_COUNT; ++i) {
+            if (m_present.test(i)) {
+                callable(static_cast<StylesheetPropertyId>(i + 1), m_values[i]);
+            }
+        }
+    }
+private:
+    // Unknown isn't stored.
+    static size_t index(StylesheetPropertyId id) { return static_cast<size_t>(id) - 1; }
 private:
-    int m_scalar{ };
-    Unit m_unit{ Unit::Pixels };
+    std::bitset<STYLESHEET_PROPERTY_COUNT> m_present{ };
+    std::array<StylesheetValue, STYLESHEET_PROPERTY_COUNT> m_values{ };
 };
 
 class StylesheetDeclaration {
 public:
-    using PropertyMap = std::map<StylesheetPropertyId, StylesheetValue *>;
-    using CustomPropertyMap = std::map<std::string, StylesheetValue *>;
+    using CustomPropertyMap = std::map<std::string, std::string>;
 
 public:
     explicit StylesheetDeclaration(std::vector<Selector> selectors);
     StylesheetDeclaration() = default;
-    StylesheetDeclaration(const StylesheetDeclaration &);
-    StylesheetDeclaration(StylesheetDeclaration &&) noexcept;
-    ~StylesheetDeclaration();
 
-    [[nodiscard]] const PropertyMap &properties() const { return m_properties; }
+    [[nodiscard]] const StylesheetPropertyBlock &properties() const { return m_properties; }
     [[nodiscard]] const CustomPropertyMap &custom_properties() const { return m_custom_properties; }
 
     [[nodiscard]] const std::vector<Selector> &selectors() const { return m_selectors; }
-    void set_selectors(std::vector<Selector> selector) { m_selectors = std::move(selector); }
+    void set_selectors(std::vector<Selector> selector);
 
     bool match(Node &dom_node) const;
     bool match(Node &dom_node, const Selector **first_matching_selector) const;
+    bool match(Node &dom_node, const AncestorFilter *) const;
 
-    [[nodiscard]] uint32_t weight() const;
+    [[nodiscard]] uint32_t weight() const { return m_weight; }
+    // Position in the cascade (by weight, then source order) among every declaration of the
+    // document, assigned by DocumentNode::index_stylesheets(). Lower is applied first.
+    [[nodiscard]] uint32_t cascade_order() const { return m_cascade_order; }
+    void set_cascade_order(uint32_t order) { m_cascade_order = order; }
 
     [[nodiscard]] bool has_property(StylesheetPropertyId) const;
     [[nodiscard]] bool has_property(const std::string &) const;
     [[nodiscard]] const StylesheetValue &property(StylesheetPropertyId) const;
-    [[nodiscard]] const StylesheetValue &property(const std::string &) const;
+    [[nodiscard]] const std::string &custom_property(const std::string &) const;
 
     void set_property(StylesheetPropertyId, std::string);
+    void set_property(StylesheetPropertyId, StylesheetValue);
     void set_property(const std::string &, std::string);
-    void set_property_ptr(StylesheetPropertyId, StylesheetValue *);
-    void set_property_ptr(const std::string &, StylesheetValue *);
     void unset_property(StylesheetPropertyId);
     void unset_property(const std::string &);
 
     static StylesheetPropertyId property_id_from_string(const std::string &);
-    static StylesheetValue *create_stylesheet_value(StylesheetPropertyId, std::string);
+    static StylesheetValue::Kind property_kind(StylesheetPropertyId);
+    static StylesheetPropertyEffect property_effect(StylesheetPropertyId);
+private:
+    [[nodiscard]] uint32_t compute_weight() const;
 private:
     std::vector<Selector> m_selectors;
-    PropertyMap m_properties{ }; // Properties, standardized.
+    uint32_t m_weight{ 0 };
+    uint32_t m_cascade_order{ 0 };
+    StylesheetPropertyBlock m_properties{ }; // Properties, standardized.
     CustomPropertyMap m_custom_properties{ }; // Custom properties, unknown.
 };
 